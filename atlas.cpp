@@ -0,0 +1,130 @@
+#include "atlas.h"
+#include "bitboard.h"
+#include <SDL2/SDL_image.h>
+#include <algorithm>
+#include <initializer_list>
+#include <iostream>
+#include <string>
+
+namespace {
+    const char* const PieceNames[6] = { "pawn", "knight", "bishop", "rook", "queen", "king" };
+    const int AtlasColumns = 8;
+
+    std::string spritePath(int sprite) {
+        if (sprite == SPRITE_HIGHLIGHT) {
+            return "images/highlightxcf.png";
+        }
+        std::string color = pieceColor(sprite) == WHITE ? "white_" : "black_";
+        return "images/" + color + PieceNames[pieceType(sprite)] + ".png";
+    }
+}
+
+TextureAtlas::TextureAtlas()
+    : m_renderer(nullptr), m_texture(nullptr), m_sources(), m_width(0), m_height(0) {
+    m_vertices.reserve(64 * 4 * 2);
+    m_indices.reserve(64 * 6 * 2);
+}
+
+TextureAtlas::~TextureAtlas() {
+    release();
+}
+
+void TextureAtlas::release() {
+    SDL_DestroyTexture(m_texture);
+    m_texture = nullptr;
+}
+
+bool TextureAtlas::load(SDL_Renderer* renderer) {
+    release();
+    m_renderer = renderer;
+
+    SDL_Surface* images[SPRITE_COUNT] = {};
+    int tileWidth = 0, tileHeight = 0;
+    bool ok = true;
+    for (int sprite = 0; sprite < SPRITE_COUNT && ok; ++sprite) {
+        SDL_Surface* image = IMG_Load(spritePath(sprite).c_str());
+        if (!image) {
+            std::cerr << "Failed to load image: " << IMG_GetError() << std::endl;
+            ok = false;
+            break;
+        }
+        images[sprite] = SDL_ConvertSurfaceFormat(image, SDL_PIXELFORMAT_RGBA32, 0);
+        SDL_FreeSurface(image);
+        if (!images[sprite]) {
+            ok = false;
+            break;
+        }
+        tileWidth = std::max(tileWidth, images[sprite]->w);
+        tileHeight = std::max(tileHeight, images[sprite]->h);
+    }
+
+    SDL_Surface* sheet = nullptr;
+    if (ok) {
+        int rows = (SPRITE_COUNT + AtlasColumns - 1) / AtlasColumns;
+        m_width = tileWidth * AtlasColumns;
+        m_height = tileHeight * rows;
+        sheet = SDL_CreateRGBSurfaceWithFormat(0, m_width, m_height, 32, SDL_PIXELFORMAT_RGBA32);
+        ok = sheet != nullptr;
+    }
+    for (int sprite = 0; sprite < SPRITE_COUNT && ok; ++sprite) {
+        // Copy the pixels as they are, alpha included
+        SDL_Rect& src = m_sources[sprite];
+        src = { sprite % AtlasColumns * tileWidth, sprite / AtlasColumns * tileHeight, images[sprite]->w, images[sprite]->h };
+        SDL_SetSurfaceBlendMode(images[sprite], SDL_BLENDMODE_NONE);
+        SDL_BlitSurface(images[sprite], nullptr, sheet, &src);
+    }
+    if (ok) {
+        m_texture = SDL_CreateTextureFromSurface(renderer, sheet);
+        ok = m_texture != nullptr;
+    }
+    if (m_texture) {
+        SDL_SetTextureBlendMode(m_texture, SDL_BLENDMODE_BLEND);
+    } else {
+        std::cerr << "Failed to build the texture atlas: " << SDL_GetError() << std::endl;
+    }
+
+    SDL_FreeSurface(sheet);
+    for (SDL_Surface* image : images) {
+        SDL_FreeSurface(image);
+    }
+    return ok;
+}
+
+void TextureAtlas::queue(int sprite, const SDL_Rect& dst) {
+    const SDL_Rect& src = m_sources[sprite];
+    float u0 = float(src.x) / m_width, v0 = float(src.y) / m_height;
+    float u1 = float(src.x + src.w) / m_width, v1 = float(src.y + src.h) / m_height;
+    float x0 = float(dst.x), y0 = float(dst.y), x1 = float(dst.x + dst.w), y1 = float(dst.y + dst.h);
+    SDL_Color white = { 255, 255, 255, 255 };
+
+    int first = int(m_vertices.size());
+    m_vertices.push_back({ { x0, y0 }, white, { u0, v0 } });
+    m_vertices.push_back({ { x1, y0 }, white, { u1, v0 } });
+    m_vertices.push_back({ { x1, y1 }, white, { u1, v1 } });
+    m_vertices.push_back({ { x0, y1 }, white, { u0, v1 } });
+    for (int corner : { 0, 1, 2, 0, 2, 3 }) {
+        m_indices.push_back(first + corner);
+    }
+}
+
+void TextureAtlas::flush() {
+    if (m_texture && !m_vertices.empty()) {
+#if SDL_VERSION_ATLEAST(2, 0, 18)
+        SDL_RenderGeometry(m_renderer, m_texture, m_vertices.data(), int(m_vertices.size()),
+                           m_indices.data(), int(m_indices.size()));
+#else
+        // No geometry API, one copy per quad from the same texture
+        for (size_t i = 0; i < m_vertices.size(); i += 4) {
+            const SDL_Vertex* v = &m_vertices[i];
+            SDL_Rect src = { int(v[0].tex_coord.x * m_width + 0.5f), int(v[0].tex_coord.y * m_height + 0.5f),
+                             int((v[2].tex_coord.x - v[0].tex_coord.x) * m_width + 0.5f),
+                             int((v[2].tex_coord.y - v[0].tex_coord.y) * m_height + 0.5f) };
+            SDL_Rect dst = { int(v[0].position.x), int(v[0].position.y),
+                             int(v[2].position.x - v[0].position.x), int(v[2].position.y - v[0].position.y) };
+            SDL_RenderCopy(m_renderer, m_texture, &src, &dst);
+        }
+#endif
+    }
+    m_vertices.clear();
+    m_indices.clear();
+}
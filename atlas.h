@@ -0,0 +1,46 @@
+// Every sprite of the board in one texture.
+//
+// The twelve piece images and the highlight overlay are decoded once at
+// startup and packed side by side into a single atlas. A frame queues
+// quads and flushes them with one SDL_RenderGeometry call, so drawing no
+// longer touches the disk or switches textures.
+
+#ifndef ATLAS_H
+#define ATLAS_H
+
+#include <SDL2/SDL.h>
+#include <vector>
+
+// Piece codes (makePiece) double as sprite ids, the overlays follow.
+enum Sprite {
+    SPRITE_HIGHLIGHT = 12,
+    SPRITE_COUNT
+};
+
+class TextureAtlas {
+private:
+    SDL_Renderer* m_renderer;
+    SDL_Texture* m_texture;
+    SDL_Rect m_sources[SPRITE_COUNT];
+    int m_width, m_height;
+    std::vector<SDL_Vertex> m_vertices;  // Reused between frames
+    std::vector<int> m_indices;
+
+public:
+    TextureAtlas();
+    ~TextureAtlas();
+    TextureAtlas(const TextureAtlas&) = delete;
+    TextureAtlas& operator=(const TextureAtlas&) = delete;
+
+    // Loads the images from the images directory and builds the texture.
+    bool load(SDL_Renderer* renderer);
+    // Destroys the texture, must run before its renderer is destroyed.
+    void release();
+
+    // Adds sprite stretched over dst to the current batch.
+    void queue(int sprite, const SDL_Rect& dst);
+    // Draws the queued sprites and empties the batch.
+    void flush();
+};
+
+#endif
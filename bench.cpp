@@ -0,0 +1,341 @@
+// Micro-benchmarks of the rules and rendering paths the GUI runs on every
+// click and frame, over a fixed corpus of positions.
+//
+//   bench [--baseline file.json] [--save file.json] [--threshold percent]
+//         [--min-time ms] [--filter text]
+//
+// Prints one JSON document with the time and heap allocations per
+// operation of every case. With --baseline each case also gets the
+// baseline's time and the change, and the exit code is 1 if any case got
+// slower by more than the threshold (10% by default). --save writes the
+// results for use as a later baseline. The render cases draw with SDL's
+// software renderer on the dummy video driver, so no display is needed;
+// they are left out if SDL cannot start. Run it from the directory that
+// holds the images.
+
+#include "game.h"
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <fstream>
+#include <functional>
+#include <map>
+#include <new>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+    std::atomic<uint64_t> allocations(0);
+}
+
+// Every heap allocation of the program goes through here and is counted
+__attribute__((noinline)) void* operator new(size_t size) {
+    allocations.fetch_add(1, std::memory_order_relaxed);
+    if (void* p = std::malloc(size ? size : 1)) {
+        return p;
+    }
+    throw std::bad_alloc();
+}
+
+__attribute__((noinline)) void operator delete(void* p) noexcept {
+    std::free(p);
+}
+
+__attribute__((noinline)) void operator delete(void* p, size_t) noexcept {
+    std::free(p);
+}
+
+namespace {
+    const char* Corpus[] = {
+        "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1",
+        "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1",
+        "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1",
+        "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1",
+        "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8",
+        "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10",
+        "r1bqkbnr/pppp1ppp/2n5/4p3/2B1P3/5Q2/PPPP1PPP/RNB1K1NR b KQkq - 3 3",
+        "rnb1kbnr/pppp1ppp/8/4p3/6Pq/5P2/PPPPP2P/RNBQKBNR w KQkq - 1 3",  // Checkmate
+        "7k/5Q2/6K1/8/8/8/8/8 b - - 0 1",                                   // Stalemate
+        "8/8/4k3/8/2p5/8/B2P2K1/8 w - - 0 1",
+    };
+
+    // Accumulates the time and allocations of the measured parts of a case,
+    // so set-up work between operations can be left out.
+    class Timer {
+    private:
+        std::chrono::steady_clock::time_point m_start;
+        uint64_t m_allocationsAtStart;
+        uint64_t m_ns;
+        uint64_t m_allocations;
+
+    public:
+        Timer() : m_allocationsAtStart(0), m_ns(0), m_allocations(0) {}
+
+        void resume() {
+            m_allocationsAtStart = allocations.load(std::memory_order_relaxed);
+            m_start = std::chrono::steady_clock::now();
+        }
+        void pause() {
+            m_ns += uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start).count());
+            m_allocations += allocations.load(std::memory_order_relaxed) - m_allocationsAtStart;
+        }
+        uint64_t ns() const { return m_ns; }
+        uint64_t allocationCount() const { return m_allocations; }
+    };
+
+    // One pass over the corpus, runs while the timer is running and returns
+    // the operations done.
+    typedef std::function<uint64_t(Timer&)> Pass;
+
+    struct Result {
+        std::string name;
+        uint64_t ops;
+        double nsPerOp;
+        double allocationsPerOp;
+    };
+
+    volatile uint64_t sink;  // Results go here so the measured calls are not optimised away
+
+    int minTimeMs = 300;
+    std::string filter;
+    std::vector<Result> results;
+
+    void run(const std::string& name, const Pass& pass) {
+        if (!filter.empty() && name.find(filter) == std::string::npos) {
+            return;
+        }
+        Timer warmUp;
+        warmUp.resume();
+        pass(warmUp);
+        warmUp.pause();
+
+        Timer timer;
+        uint64_t ops = 0;
+        do {
+            timer.resume();
+            ops += pass(timer);
+            timer.pause();
+        } while (timer.ns() < uint64_t(minTimeMs) * 1000000);
+        results.push_back({ name, ops, double(timer.ns()) / ops, double(timer.allocationCount()) / ops });
+        std::fprintf(stderr, "%-28s %10.1f ns/op\n", name.c_str(), results.back().nsPerOp);
+    }
+
+    // A legal move of the side to move that a click pair can play.
+    Move clickableMove(const Position& position) {
+        MoveList moves;
+        generateLegalMoves(position, moves);
+        for (Move move : moves) {
+            if (!move.isPromotion() || move.promotion() == QUEEN) {
+                return move;
+            }
+        }
+        return Move::none();
+    }
+
+    // Sets up each position off the clock, then selects the moving piece
+    // and clicks its target.
+    uint64_t clickRoundTrip(Game& game, const std::vector<Position>& positions, Timer& timer, bool render) {
+        uint64_t ops = 0;
+        for (const Position& position : positions) {
+            Move move = clickableMove(position);
+            if (move == Move::none()) {
+                continue;
+            }
+            timer.pause();
+            game.setPosition(position.toFen());
+            if (render) {
+                game.render();
+            }
+            timer.resume();
+            game.handleClick(squareX(move.from()), squareY(move.from()));
+            game.handleClick(squareX(move.to()), squareY(move.to()));
+            if (render) {
+                game.render();
+            }
+            ++ops;
+        }
+        return ops;
+    }
+
+    const char* PieceNames[6] = { "pawn", "knight", "bishop", "rook", "queen", "king" };
+
+    void runRules(const std::vector<Position>& positions) {
+        // Sprites of the side to move by type, each with its position
+        Game game;
+        std::vector<std::pair<const Position*, std::unique_ptr<Piece>>> pieces[6];
+        for (const Position& position : positions) {
+            for (int pt = PAWN; pt <= KING; ++pt) {
+                for (Bitboard b = position.pieces(position.sideToMove(), PieceType(pt)); b;) {
+                    int sq = popLsb(b);
+                    pieces[pt].emplace_back(&position, std::unique_ptr<Piece>(
+                        game.createPiece(makePiece(position.sideToMove(), PieceType(pt)), squareX(sq), squareY(sq))));
+                }
+            }
+        }
+        for (int pt = PAWN; pt <= KING; ++pt) {
+            run(std::string("getValidMoves/") + PieceNames[pt], [&pieces, pt](Timer&) {
+                for (const auto& entry : pieces[pt]) {
+                    sink = sink + entry.second->getValidMoves(*entry.first).size();
+                }
+                return uint64_t(pieces[pt].size());
+            });
+        }
+
+        std::vector<std::unique_ptr<Game>> games;
+        for (const Position& position : positions) {
+            games.emplace_back(new Game());
+            games.back()->setPosition(position.toFen());
+        }
+        run("isKingInCheck", [&games](Timer&) {
+            for (const auto& g : games) {
+                sink = sink + g->isKingInCheck(true) + g->isKingInCheck(false);
+            }
+            return uint64_t(2 * games.size());
+        });
+        run("isCheckmate", [&games](Timer&) {
+            for (const auto& g : games) {
+                sink = sink + g->isCheckmate(g->isWhiteTurn());
+            }
+            return uint64_t(games.size());
+        });
+        run("isStalemate", [&games](Timer&) {
+            for (const auto& g : games) {
+                sink = sink + g->isStalemate(g->isWhiteTurn());
+            }
+            return uint64_t(games.size());
+        });
+        run("handleClick/roundTrip", [&game, &positions](Timer& timer) {
+            return clickRoundTrip(game, positions, timer, false);
+        });
+    }
+
+    void runRender(const std::vector<Position>& positions) {
+        SDL_SetHint(SDL_HINT_VIDEODRIVER, "dummy");
+        Game game;
+        if (!game.init(true)) {
+            std::fprintf(stderr, "SDL did not start, render cases skipped\n");
+            return;
+        }
+        run("render/full", [&game, &positions](Timer& timer) {
+            for (const Position& position : positions) {
+                timer.pause();
+                game.setPosition(position.toFen());
+                timer.resume();
+                game.invalidate();
+                game.render();
+            }
+            return uint64_t(positions.size());
+        });
+        run("render/click", [&game, &positions](Timer& timer) {
+            return clickRoundTrip(game, positions, timer, true);
+        });
+    }
+
+    // Reads the ns/op per case name from a file written by --save.
+    bool loadBaseline(const std::string& path, std::map<std::string, double>& baseline) {
+        std::ifstream in(path);
+        if (!in) {
+            return false;
+        }
+        std::stringstream ss;
+        ss << in.rdbuf();
+        std::string text = ss.str();
+        const std::string nameKey = "\"name\": \"", nsKey = "\"ns_per_op\": ";
+        for (size_t pos = text.find(nameKey); pos != std::string::npos; pos = text.find(nameKey, pos)) {
+            pos += nameKey.size();
+            size_t end = text.find('"', pos);
+            size_t ns = text.find(nsKey, end);
+            if (end == std::string::npos || ns == std::string::npos) {
+                break;
+            }
+            baseline[text.substr(pos, end - pos)] = std::atof(text.c_str() + ns + nsKey.size());
+        }
+        return true;
+    }
+
+    std::string toJson(const std::map<std::string, double>& baseline, double threshold, int& regressions) {
+        std::ostringstream os;
+        char line[256];
+        regressions = 0;
+        os << "{\n  \"cases\": [\n";
+        for (size_t i = 0; i < results.size(); ++i) {
+            const Result& r = results[i];
+            std::snprintf(line, sizeof(line), "    { \"name\": \"%s\", \"ops\": %llu, \"ns_per_op\": %.2f, \"allocs_per_op\": %.3f",
+                          r.name.c_str(), static_cast<unsigned long long>(r.ops), r.nsPerOp, r.allocationsPerOp);
+            os << line;
+            auto it = baseline.find(r.name);
+            if (it != baseline.end() && it->second > 0) {
+                double change = (r.nsPerOp / it->second - 1) * 100;
+                bool regression = change > threshold;
+                regressions += regression;
+                std::snprintf(line, sizeof(line), ", \"baseline_ns_per_op\": %.2f, \"change_percent\": %.1f, \"regression\": %s",
+                              it->second, change, regression ? "true" : "false");
+                os << line;
+            }
+            os << " }" << (i + 1 < results.size() ? "," : "") << "\n";
+        }
+        os << "  ],\n  \"regressions\": " << regressions << "\n}\n";
+        return os.str();
+    }
+
+    void usage() {
+        std::fprintf(stderr, "Usage: bench [--baseline file.json] [--save file.json] [--threshold percent]\n"
+                             "             [--min-time ms] [--filter text]\n");
+    }
+}
+
+int main(int argc, char* argv[]) {
+    std::string baselinePath, savePath;
+    double threshold = 10;
+    for (int i = 1; i < argc; ++i) {
+        if (i + 1 >= argc) {
+            usage();
+            return 1;
+        }
+        if (std::strcmp(argv[i], "--baseline") == 0) {
+            baselinePath = argv[++i];
+        } else if (std::strcmp(argv[i], "--save") == 0) {
+            savePath = argv[++i];
+        } else if (std::strcmp(argv[i], "--threshold") == 0) {
+            threshold = std::atof(argv[++i]);
+        } else if (std::strcmp(argv[i], "--min-time") == 0) {
+            minTimeMs = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--filter") == 0) {
+            filter = argv[++i];
+        } else {
+            usage();
+            return 1;
+        }
+    }
+    Bitboards::init();
+
+    std::map<std::string, double> baseline;
+    if (!baselinePath.empty() && !loadBaseline(baselinePath, baseline)) {
+        std::fprintf(stderr, "Cannot read baseline %s\n", baselinePath.c_str());
+        return 1;
+    }
+    std::vector<Position> positions;
+    for (const char* fen : Corpus) {
+        positions.emplace_back();
+        positions.back().setFromFen(fen);
+    }
+
+    runRules(positions);
+    runRender(positions);
+
+    int regressions;
+    std::string json = toJson(baseline, threshold, regressions);
+    std::fputs(json.c_str(), stdout);
+    if (!savePath.empty()) {
+        std::ofstream out(savePath);
+        out << json;
+        if (!out) {
+            std::fprintf(stderr, "Cannot write %s\n", savePath.c_str());
+            return 1;
+        }
+    }
+    return regressions ? 1 : 0;
+}
@@ -0,0 +1,171 @@
+#include "bitboard.h"
+#include <immintrin.h>
+#include <initializer_list>
+
+Magic RookMagics[64];
+Magic BishopMagics[64];
+bool UsePext = false;
+
+namespace {
+    Bitboard PawnAttacks[2][64];
+    Bitboard KnightAttacks[64];
+    Bitboard KingAttacks[64];
+    Bitboard BetweenBB[64][64];
+    Bitboard LineBB[64][64];
+    Bitboard RookTable[0x19000];
+    Bitboard BishopTable[0x1480];
+
+    // Adds the target of a (df, dr) step if it stays on the board.
+    Bitboard stepTarget(int sq, int df, int dr) {
+        int f = squareFile(sq) + df;
+        int r = squareRank(sq) + dr;
+        if (f < 0 || f > 7 || r < 0 || r > 7) {
+            return 0;
+        }
+        return squareBB(r * 8 + f);
+    }
+
+    // Walks one ray until it leaves the board or hits a blocker (included).
+    Bitboard rayAttacks(int sq, int df, int dr, Bitboard occupied) {
+        Bitboard attacks = 0;
+        int f = squareFile(sq) + df;
+        int r = squareRank(sq) + dr;
+        while (f >= 0 && f <= 7 && r >= 0 && r <= 7) {
+            Bitboard b = squareBB(r * 8 + f);
+            attacks |= b;
+            if (occupied & b) {
+                break;
+            }
+            f += df;
+            r += dr;
+        }
+        return attacks;
+    }
+
+    Bitboard slidingAttacks(PieceType pt, int sq, Bitboard occupied) {
+        if (pt == ROOK) {
+            return rayAttacks(sq, 1, 0, occupied) | rayAttacks(sq, -1, 0, occupied)
+                 | rayAttacks(sq, 0, 1, occupied) | rayAttacks(sq, 0, -1, occupied);
+        }
+        return rayAttacks(sq, 1, 1, occupied) | rayAttacks(sq, -1, 1, occupied)
+             | rayAttacks(sq, 1, -1, occupied) | rayAttacks(sq, -1, -1, occupied);
+    }
+
+    // xorshift64star, only used to search for magic numbers
+    class PRNG {
+    private:
+        uint64_t m_state;
+
+    public:
+        explicit PRNG(uint64_t seed) : m_state(seed) {}
+
+        uint64_t rand() {
+            m_state ^= m_state >> 12;
+            m_state ^= m_state << 25;
+            m_state ^= m_state >> 27;
+            return m_state * 2685821657736338717ULL;
+        }
+
+        // Magics work best with few bits set
+        uint64_t sparseRand() { return rand() & rand() & rand(); }
+    };
+
+    // Fills the attack table of one slider type. With PEXT the index is the
+    // blockers compacted under the mask, otherwise a magic is searched that
+    // maps every blocker subset to a slot without destructive collisions.
+    void initSliders(PieceType pt, Bitboard table[], Magic magics[]) {
+        const uint64_t seeds[8] = { 728, 10316, 55013, 32803, 12281, 15100, 16645, 255 };
+        Bitboard occupancy[4096], reference[4096];
+        int epoch[4096] = {}, attempt = 0;
+
+        for (int sq = 0; sq < 64; ++sq) {
+            Bitboard rankEdges = (RANK_1_BB | RANK_8_BB) & ~(RANK_1_BB << (8 * squareRank(sq)));
+            Bitboard fileEdges = (FILE_A_BB | FILE_H_BB) & ~(FILE_A_BB << squareFile(sq));
+            Magic& m = magics[sq];
+            m.mask = slidingAttacks(pt, sq, 0) & ~(rankEdges | fileEdges);
+            m.shift = 64 - popCount(m.mask);
+            m.attacks = (sq == 0) ? table : magics[sq - 1].attacks + (1 << (64 - magics[sq - 1].shift));
+
+            // Carry-Rippler trick enumerates every subset of the mask
+            int size = 0;
+            Bitboard b = 0;
+            do {
+                occupancy[size] = b;
+                reference[size] = slidingAttacks(pt, sq, b);
+                if (UsePext) {
+                    m.attacks[pextIndex(b, m.mask)] = reference[size];
+                }
+                ++size;
+                b = (b - m.mask) & m.mask;
+            } while (b);
+
+            if (UsePext) {
+                continue;
+            }
+
+            PRNG rng(seeds[squareRank(sq)]);
+            for (int i = 0; i < size;) {
+                for (m.magic = 0; popCount((m.magic * m.mask) >> 56) < 6;) {
+                    m.magic = rng.sparseRand();
+                }
+                // Epochs avoid clearing the table between attempts
+                for (++attempt, i = 0; i < size; ++i) {
+                    unsigned idx = unsigned(((occupancy[i] & m.mask) * m.magic) >> m.shift);
+                    if (epoch[idx] < attempt) {
+                        epoch[idx] = attempt;
+                        m.attacks[idx] = reference[i];
+                    } else if (m.attacks[idx] != reference[i]) {
+                        break;
+                    }
+                }
+            }
+        }
+    }
+}
+
+__attribute__((target("bmi2")))
+unsigned pextIndex(Bitboard occupied, Bitboard mask) {
+    return unsigned(_pext_u64(occupied, mask));
+}
+
+void Bitboards::init(bool allowPext) {
+    const int knightDf[] = { 2, 1, -1, -2, -2, -1, 1, 2 };
+    const int knightDr[] = { 1, 2, 2, 1, -1, -2, -2, -1 };
+    const int kingDf[] = { 1, 1, 1, 0, -1, -1, -1, 0 };
+    const int kingDr[] = { 1, 0, -1, -1, -1, 0, 1, 1 };
+
+    for (int sq = 0; sq < 64; ++sq) {
+        PawnAttacks[WHITE][sq] = stepTarget(sq, -1, 1) | stepTarget(sq, 1, 1);
+        PawnAttacks[BLACK][sq] = stepTarget(sq, -1, -1) | stepTarget(sq, 1, -1);
+        KnightAttacks[sq] = 0;
+        KingAttacks[sq] = 0;
+        for (int i = 0; i < 8; ++i) {
+            KnightAttacks[sq] |= stepTarget(sq, knightDf[i], knightDr[i]);
+            KingAttacks[sq] |= stepTarget(sq, kingDf[i], kingDr[i]);
+        }
+    }
+
+    __builtin_cpu_init();
+    UsePext = allowPext && __builtin_cpu_supports("bmi2");
+    initSliders(ROOK, RookTable, RookMagics);
+    initSliders(BISHOP, BishopTable, BishopMagics);
+
+    for (int a = 0; a < 64; ++a) {
+        for (int b = 0; b < 64; ++b) {
+            BetweenBB[a][b] = LineBB[a][b] = 0;
+            for (PieceType pt : { BISHOP, ROOK }) {
+                if (a != b && (slidingAttacks(pt, a, 0) & squareBB(b))) {
+                    LineBB[a][b] = (slidingAttacks(pt, a, 0) & slidingAttacks(pt, b, 0)) | squareBB(a) | squareBB(b);
+                    BetweenBB[a][b] = slidingAttacks(pt, a, squareBB(b)) & slidingAttacks(pt, b, squareBB(a));
+                }
+            }
+        }
+    }
+}
+
+Bitboard pawnAttacks(Color c, int sq) { return PawnAttacks[c][sq]; }
+Bitboard knightAttacks(int sq) { return KnightAttacks[sq]; }
+Bitboard kingAttacks(int sq) { return KingAttacks[sq]; }
+Bitboard betweenBB(int a, int b) { return BetweenBB[a][b]; }
+Bitboard lineBB(int a, int b) { return LineBB[a][b]; }
+
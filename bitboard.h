@@ -0,0 +1,99 @@
+// Bitboard primitives shared by the position and the move generation.
+// Squares are numbered a1 = 0 ... h8 = 63, the screen uses x = file and
+// y = 7 - rank, so the black back rank is drawn on top.
+
+#ifndef BITBOARD_H
+#define BITBOARD_H
+
+#include <cstdint>
+
+typedef uint64_t Bitboard;
+
+enum Color { WHITE, BLACK };
+
+enum PieceType { PAWN, KNIGHT, BISHOP, ROOK, QUEEN, KING };
+
+// A coloured piece is color * 6 + type, 12 is an empty square.
+const int NO_PIECE = 12;
+const int NO_SQUARE = 64;
+
+inline int makePiece(Color c, PieceType pt) { return c * 6 + pt; }
+inline Color pieceColor(int piece) { return Color(piece / 6); }
+inline PieceType pieceType(int piece) { return PieceType(piece % 6); }
+inline Color operator~(Color c) { return Color(c ^ 1); }
+
+inline int makeSquare(int x, int y) { return (7 - y) * 8 + x; }
+inline int squareX(int sq) { return sq & 7; }
+inline int squareY(int sq) { return 7 - (sq >> 3); }
+inline int squareFile(int sq) { return sq & 7; }
+inline int squareRank(int sq) { return sq >> 3; }
+
+inline Bitboard squareBB(int sq) { return Bitboard(1) << sq; }
+inline int popCount(Bitboard b) { return __builtin_popcountll(b); }
+inline int lsb(Bitboard b) { return __builtin_ctzll(b); }
+inline int popLsb(Bitboard& b) {
+    int sq = lsb(b);
+    b &= b - 1;
+    return sq;
+}
+
+const Bitboard FILE_A_BB = 0x0101010101010101ULL;
+const Bitboard FILE_H_BB = FILE_A_BB << 7;
+const Bitboard RANK_1_BB = 0xFFULL;
+const Bitboard RANK_2_BB = RANK_1_BB << 8;
+const Bitboard RANK_8_BB = RANK_1_BB << 56;
+
+// Slider attacks are looked up in tables indexed by the relevant blockers,
+// either with a BMI2 PEXT or with the classic magic multiply and shift.
+struct Magic {
+    Bitboard mask;
+    Bitboard magic;
+    Bitboard* attacks;
+    unsigned shift;
+
+    unsigned index(Bitboard occupied) const;
+};
+
+extern Magic RookMagics[64];
+extern Magic BishopMagics[64];
+extern bool UsePext;
+
+namespace Bitboards {
+    // Builds the lookup tables, must run once before any position is used.
+    // PEXT indexing is picked when the CPU has BMI2 and allowPext is set.
+    void init(bool allowPext = true);
+}
+
+unsigned pextIndex(Bitboard occupied, Bitboard mask);
+
+inline unsigned Magic::index(Bitboard occupied) const {
+    if (UsePext) {
+        return pextIndex(occupied, mask);
+    }
+    return unsigned(((occupied & mask) * magic) >> shift);
+}
+
+Bitboard pawnAttacks(Color c, int sq);
+Bitboard knightAttacks(int sq);
+Bitboard kingAttacks(int sq);
+
+// Squares strictly between a and b, empty unless they share a line or diagonal.
+Bitboard betweenBB(int a, int b);
+// The whole line or diagonal through a and b, empty if they are not aligned.
+Bitboard lineBB(int a, int b);
+
+inline Bitboard bishopAttacks(int sq, Bitboard occupied) {
+    const Magic& m = BishopMagics[sq];
+    return m.attacks[m.index(occupied)];
+}
+
+inline Bitboard rookAttacks(int sq, Bitboard occupied) {
+    const Magic& m = RookMagics[sq];
+    return m.attacks[m.index(occupied)];
+}
+
+inline Bitboard queenAttacks(int sq, Bitboard occupied) {
+    return bishopAttacks(sq, occupied) | rookAttacks(sq, occupied);
+}
+
+#endif
@@ -0,0 +1,65 @@
+// Opening book in the Polyglot .bin layout: 16-byte big-endian entries
+// (key, move, weight, learn) sorted by key, looked up by binary search in
+// a memory-mapped file. Opening a book only maps it, pages are read when a
+// lookup touches them.
+//
+// Entries are keyed by the Polyglot hash, so books from other Polyglot tools
+// and the ones BookBuild makes work both ways.
+
+#ifndef BOOK_H
+#define BOOK_H
+
+#include "mapped_file.h"
+#include "position.h"
+#include <cstdint>
+#include <string>
+
+struct BookEntry {
+    uint64_t key;
+    uint16_t move;    // Polyglot move encoding, see encodeBookMove
+    uint16_t weight;
+    uint32_t learn;
+};
+
+const int BookEntrySize = 16;
+
+class OpeningBook {
+public:
+    static const int MaxMoves = 64;  // Moves looked at per position
+
+private:
+    MappedFile m_file;
+    size_t m_count;
+
+public:
+    OpeningBook() : m_count(0) {}
+
+    // False if the file cannot be mapped or is not made of whole entries.
+    bool open(const std::string& path);
+    void close();
+    bool isOpen() const { return m_count > 0; }
+    size_t size() const { return m_count; }
+
+    // Legal book moves of position with their weights, returns how many.
+    int lookup(const Position& position, Move moves[], int weights[], int maxMoves) const;
+    // Picks a book move with probability proportional to its weight,
+    // random is a uniform 32-bit number. Move::none() when out of book.
+    // Neither call allocates.
+    Move probe(const Position& position, uint32_t random) const;
+
+private:
+    BookEntry entry(size_t i) const;
+};
+
+// Key of position in a Polyglot book. It is not the engine's Zobrist key.
+uint64_t polyglotKey(const Position& position);
+
+// Polyglot move bits: to file 0-2, to rank 3-5, from file 6-8, from rank
+// 9-11, promotion 12-14 (1 knight ... 4 queen). Castling is stored as the
+// king taking its own rook.
+uint16_t encodeBookMove(Move move);
+Move decodeBookMove(const Position& position, uint16_t data);
+
+void writeBookEntry(unsigned char out[BookEntrySize], const BookEntry& entry);
+
+#endif
@@ -0,0 +1,214 @@
+// Builds an opening book (book.h) from a PGN archive.
+//
+//   bookbuild [--threads n] [--plies n] [--min-games n] <games.pgn> <book.bin>
+//
+// The archive is memory-mapped and cut into chunks of whole games. Each
+// chunk is replayed on the work-stealing pool into a run of (key, move)
+// records that is sorted and combined locally. The runs are then merged in
+// pairs, also on the pool, until one sorted run is left for the writer.
+// A move scores 2 for a win and 1 for a draw of the side that played it.
+
+#include "book.h"
+#include "pgn.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <vector>
+
+namespace {
+    struct Record {
+        uint64_t key;
+        uint16_t move;
+        uint32_t score;
+        uint32_t games;
+
+        bool operator<(const Record& other) const {
+            return key != other.key ? key < other.key : move < other.move;
+        }
+        bool sameMove(const Record& other) const { return key == other.key && move == other.move; }
+    };
+
+    typedef std::vector<Record> Run;
+
+    struct Options {
+        int threads = 0;
+        int plies = 30;
+        int minGames = 1;
+    };
+
+    // Sorts run and folds the records of the same position and move together.
+    void combine(Run& run) {
+        std::sort(run.begin(), run.end());
+        size_t out = 0;
+        for (size_t i = 0; i < run.size(); ++i) {
+            if (out > 0 && run[out - 1].sameMove(run[i])) {
+                run[out - 1].score += run[i].score;
+                run[out - 1].games += run[i].games;
+            } else {
+                run[out++] = run[i];
+            }
+        }
+        run.resize(out);
+        run.shrink_to_fit();
+    }
+
+    Run merge(const Run& a, const Run& b) {
+        Run out;
+        out.reserve(a.size() + b.size());
+        size_t i = 0, j = 0;
+        while (i < a.size() || j < b.size()) {
+            const Record& next = j == b.size() || (i < a.size() && !(b[j] < a[i])) ? a[i++] : b[j++];
+            if (!out.empty() && out.back().sameMove(next)) {
+                out.back().score += next.score;
+                out.back().games += next.games;
+            } else {
+                out.push_back(next);
+            }
+        }
+        return out;
+    }
+
+    void readGames(std::string_view text, const Options& options, Run& run) {
+        PgnReader reader(text);
+        PgnGame game;
+        while (reader.next(game)) {
+            int white;  // Points of white: 2 win, 1 draw, 0 loss
+            if (game.result == "1-0") {
+                white = 2;
+            } else if (game.result == "0-1") {
+                white = 0;
+            } else if (game.result == "1/2-1/2") {
+                white = 1;
+            } else {
+                continue;  // Unfinished or unknown result
+            }
+            if (!game.legal()) {
+                continue;
+            }
+            Position position = game.start;
+            UndoRecord undo;
+            int plies = std::min<int>(int(game.moves.size()), options.plies);
+            for (int i = 0; i < plies; ++i) {
+                Move move = game.moves[i];
+                uint32_t score = position.sideToMove() == WHITE ? white : 2 - white;
+                run.push_back({ polyglotKey(position), encodeBookMove(move), score, 1 });
+                position.makeMove(move, undo);
+            }
+        }
+        combine(run);
+    }
+
+    // Weights are scaled per position so the best move fits in 16 bits.
+    // Returns false when a write fails.
+    bool writeBook(const Run& run, const Options& options, FILE* out, size_t& written) {
+        written = 0;
+        unsigned char buffer[BookEntrySize];
+        for (size_t begin = 0; begin < run.size();) {
+            size_t end = begin;
+            uint32_t best = 0;
+            while (end < run.size() && run[end].key == run[begin].key) {
+                if (int(run[end].games) >= options.minGames) {
+                    best = std::max(best, run[end].score);
+                }
+                ++end;
+            }
+            for (size_t i = begin; i < end; ++i) {
+                const Record& r = run[i];
+                if (int(r.games) < options.minGames || r.score == 0) {
+                    continue;
+                }
+                uint32_t weight = best > 0xFFFF ? uint32_t(uint64_t(r.score) * 0xFFFF / best) : r.score;
+                writeBookEntry(buffer, { r.key, r.move, uint16_t(std::max(1u, weight)), 0 });
+                if (std::fwrite(buffer, 1, BookEntrySize, out) != BookEntrySize) {
+                    return false;
+                }
+                ++written;
+            }
+            begin = end;
+        }
+        return true;
+    }
+
+    void usage() {
+        std::cerr << "Usage: bookbuild [--threads n] [--plies n] [--min-games n] <games.pgn> <book.bin>" << std::endl;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    std::vector<std::string> paths;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            options.threads = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--plies") == 0 && i + 1 < argc) {
+            options.plies = std::max(1, std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--min-games") == 0 && i + 1 < argc) {
+            options.minGames = std::max(1, std::atoi(argv[++i]));
+        } else {
+            paths.push_back(argv[i]);
+        }
+    }
+    if (paths.size() != 2) {
+        usage();
+        return 1;
+    }
+    Bitboards::init();
+
+    auto start = std::chrono::steady_clock::now();
+    MappedFile file;
+    if (!file.open(paths[0], MappedFile::SEQUENTIAL)) {
+        std::cerr << "Cannot open " << paths[0] << std::endl;
+        return 1;
+    }
+    WorkStealingPool pool(options.threads);
+
+    std::string_view text(file.data(), file.size());
+    size_t chunkBytes = std::max<size_t>(64 << 10, std::min<size_t>(16 << 20, text.size() / (pool.size() * 4) + 1));
+    std::vector<std::string_view> chunks = splitPgn(text, chunkBytes);
+    std::vector<Run> runs(chunks.size());
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        pool.submit([&, i] { readGames(chunks[i], options, runs[i]); });
+    }
+    pool.wait();
+
+    // Merge tree, every level merges its pairs in parallel
+    while (runs.size() > 1) {
+        std::vector<Run> merged((runs.size() + 1) / 2);
+        for (size_t i = 0; i < merged.size(); ++i) {
+            pool.submit([&, i] {
+                if (2 * i + 1 < runs.size()) {
+                    merged[i] = merge(runs[2 * i], runs[2 * i + 1]);
+                    Run().swap(runs[2 * i]);
+                    Run().swap(runs[2 * i + 1]);
+                } else {
+                    merged[i].swap(runs[2 * i]);
+                }
+            });
+        }
+        pool.wait();
+        runs.swap(merged);
+    }
+
+    FILE* out = std::fopen(paths[1].c_str(), "wb");
+    if (!out) {
+        std::cerr << "Cannot write " << paths[1] << std::endl;
+        return 1;
+    }
+    size_t entries = 0;
+    bool ok = runs.empty() || writeBook(runs[0], options, out, entries);
+    ok = std::fclose(out) == 0 && ok;
+    if (!ok) {
+        std::cerr << "Cannot write " << paths[1] << std::endl;
+        return 1;
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cerr << "Entries: " << entries << "  Time: " << int(seconds * 1000) << " ms  Threads: " << pool.size()
+              << "  MB/s: " << (seconds > 0 ? text.size() / seconds / (1 << 20) : 0) << std::endl;
+    return 0;
+}
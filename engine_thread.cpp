@@ -0,0 +1,107 @@
+#include "engine_thread.h"
+#include <algorithm>
+
+EngineThread::EngineThread(int hashMB, int threads, Notify notify)
+    : m_tt(hashMB), m_search(m_tt, threads), m_notify(notify), m_lastId(0), m_cancelled(0), m_ponderhit(0), m_quit(false) {
+    m_thread = std::thread([this] { loop(); });
+}
+
+EngineThread::~EngineThread() {
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    stop();
+    m_wake.notify_one();
+    m_thread.join();
+}
+
+uint32_t EngineThread::post(const Position& position, const std::vector<uint64_t>& history, const SearchLimits& limits) {
+    if (!m_requests.push({ m_lastId + 1, position, history, limits })) {
+        return 0;
+    }
+    ++m_lastId;
+    {
+        // Taking the mutex orders the push before the engine's empty check
+        std::lock_guard<std::mutex> lock(m_mutex);
+    }
+    m_wake.notify_one();
+    return m_lastId;
+}
+
+void EngineThread::stop() {
+    m_cancelled.store(m_lastId, std::memory_order_release);
+    m_search.stop();
+}
+
+void EngineThread::ponderhit(uint32_t id) {
+    m_ponderhit.store(id, std::memory_order_release);
+    m_search.ponderhit();
+}
+
+void EngineThread::loop() {
+    Request request;
+    for (;;) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [this] { return m_quit || !m_requests.empty(); });
+            if (m_quit) {
+                return;
+            }
+        }
+        while (m_requests.pop(request)) {
+            if (!cancelled(request.id)) {
+                run(request);
+            }
+        }
+    }
+}
+
+void EngineThread::run(Request& request) {
+    uint32_t id = request.id;
+    if (request.limits.ponder && m_ponderhit.load(std::memory_order_acquire) == id) {
+        request.limits.ponder = false;
+    }
+    EngineReport last = {};
+    Move best = m_search.think(request.position, request.limits, request.history, [&](const SearchInfo& info) {
+        // think() clears a stop or ponderhit that came in while it was starting
+        if (cancelled(id)) {
+            m_search.stop();
+        } else if (m_search.pondering() && m_ponderhit.load(std::memory_order_acquire) == id) {
+            m_search.ponderhit();
+        }
+        last.kind = EngineReport::INFO;
+        last.id = id;
+        last.depth = info.depth;
+        last.score = info.score;
+        last.nodes = info.nodes;
+        last.timeMs = info.timeMs;
+        last.pvLength = std::min(int(info.pv.size()), int(EngineReport::MaxPv));
+        std::copy(info.pv.begin(), info.pv.begin() + last.pvLength, last.pv);
+        report(last, false);
+    });
+
+    EngineReport result = last;
+    result.kind = EngineReport::BEST_MOVE;
+    result.id = id;
+    result.score = m_search.score();
+    result.nodes = m_search.nodes();
+    // The expected reply only goes with the move the PV starts with
+    result.pvLength = best == Move::none() ? 0 : last.pvLength > 1 && last.pv[0] == best ? 2 : 1;
+    result.pv[0] = best;
+    report(result, true);
+}
+
+// Progress reports are dropped when the caller falls behind, a result
+// waits for room unless the engine is shutting down.
+void EngineThread::report(const EngineReport& report, bool mustArrive) {
+    while (!m_reports.push(report)) {
+        if (!mustArrive || m_quit.load(std::memory_order_relaxed)) {
+            return;
+        }
+        std::this_thread::yield();
+    }
+    if (m_notify) {
+        m_notify();
+    }
+}
@@ -0,0 +1,97 @@
+// Search service on a thread of its own, so a caller with an event loop
+// never waits for the engine.
+//
+// The caller posts position snapshots and polls for reports, both through
+// lock-free single-producer/single-consumer queues: the caller is the only
+// producer of requests and the only consumer of reports. The engine thread
+// sleeps while there is nothing to do and calls the notify callback after
+// every report it queues, so the caller can wake its own loop.
+//
+// A ponder request (limits.ponder) searches the position after the move
+// the opponent is expected to play. ponderhit() turns it into the real
+// search for the engine's move with its clock starting then, stop() drops
+// it and everything else posted so far.
+
+#ifndef ENGINE_THREAD_H
+#define ENGINE_THREAD_H
+
+#include "search.h"
+#include "spsc_queue.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <functional>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+struct EngineReport {
+    static const int MaxPv = 16;
+
+    enum Kind {
+        INFO,      // An iteration completed
+        BEST_MOVE  // The search of a request ended
+    };
+
+    Kind kind;
+    uint32_t id;  // Request the report belongs to
+    int depth;
+    int score;
+    uint64_t nodes;
+    int timeMs;
+    int pvLength;
+    Move pv[MaxPv];  // For BEST_MOVE the move to play and the expected reply, if any
+};
+
+class EngineThread {
+public:
+    typedef std::function<void()> Notify;
+
+private:
+    struct Request {
+        uint32_t id;
+        Position position;
+        std::vector<uint64_t> history;
+        SearchLimits limits;
+    };
+
+    TranspositionTable m_tt;
+    Search m_search;
+    Notify m_notify;
+    SpscQueue<Request, 8> m_requests;
+    SpscQueue<EngineReport, 256> m_reports;
+    uint32_t m_lastId;                  // Caller side only
+    std::atomic<uint32_t> m_cancelled;  // Requests up to this id are dropped
+    std::atomic<uint32_t> m_ponderhit;  // Ponder request the opponent's move matched
+    std::mutex m_mutex;                 // Only for sleeping on m_wake
+    std::condition_variable m_wake;
+    std::atomic<bool> m_quit;           // Set under m_mutex so the engine cannot miss it
+    std::thread m_thread;
+
+public:
+    EngineThread(int hashMB, int threads, Notify notify = Notify());
+    ~EngineThread();
+    EngineThread(const EngineThread&) = delete;
+    EngineThread& operator=(const EngineThread&) = delete;
+
+    // Queues a search of position, history holds the keys of the earlier
+    // positions of the game. Returns the request id, 0 if too many requests
+    // are waiting.
+    uint32_t post(const Position& position, const std::vector<uint64_t>& history, const SearchLimits& limits);
+    // Next report, false if there is none.
+    bool poll(EngineReport& report) { return m_reports.pop(report); }
+
+    // Ends the running search and drops every request posted so far. Their
+    // BEST_MOVE reports may still arrive and should be ignored.
+    void stop();
+    // The ponder request id goes on as a normal search.
+    void ponderhit(uint32_t id);
+
+private:
+    void loop();
+    void run(Request& request);
+    void report(const EngineReport& report, bool mustArrive);
+    bool cancelled(uint32_t id) const { return id <= m_cancelled.load(std::memory_order_acquire); }
+};
+
+#endif
@@ -0,0 +1,9 @@
+#include "evaluate.h"
+#include <algorithm>
+
+int evaluate(const Position& position) {
+    // Promotions can push the phase past its opening value
+    int phase = std::min(position.phase(), Psqt::MaxPhase);
+    int score = (position.psqMg() * phase + position.psqEg() * (Psqt::MaxPhase - phase)) / Psqt::MaxPhase;
+    return position.sideToMove() == WHITE ? score : -score;
+}
@@ -0,0 +1,16 @@
+// Static evaluation in centipawns, from the side to move's point of view.
+//
+// Material and piece-square tables (psqt.h), blended from the middlegame to
+// the endgame values as pieces come off. Position keeps both sums up to date
+// in makeMove and unmakeMove, so evaluating is a couple of multiplications.
+
+#ifndef EVALUATE_H
+#define EVALUATE_H
+
+#include "position.h"
+
+const int PieceValue[6] = { 100, 320, 330, 500, 900, 0 };
+
+int evaluate(const Position& position);
+
+#endif
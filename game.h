@@ -0,0 +1,729 @@
+// The SDL front end: the Piece sprites and the Game that owns the window,
+// the board and the event loop. Shared by the Chess executable and the
+// Bench target.
+
+#ifndef GAME_H
+#define GAME_H
+
+#include <SDL2/SDL.h>
+#include <SDL2/SDL_image.h>
+#include <iostream>
+#include <vector>
+#include <utility>
+#include <algorithm>
+#include <unordered_map>
+#include "atlas.h"
+#include "book.h"
+#include "engine_thread.h"
+#include "geometry.h"
+#include "journal.h"
+#include "movegen.h"
+#include "profiler.h"
+#include <memory>
+#include <random>
+#include <ctime>
+#include <fstream>
+
+// Director Class for future derivations!
+// Pieces only draw themselves, the rules live in the Position.
+class Piece {
+protected:
+    int m_x, m_y;
+    int m_size;
+    bool m_isWhite;
+
+    int square() const { return makeSquare(m_x, m_y); }
+
+public:
+    Piece(int x, int y, int size, bool isWhite)
+        : m_x(x), m_y(y), m_size(size), m_isWhite(isWhite) {}
+
+    virtual ~Piece() {}
+
+    virtual PieceType getType() const = 0;
+
+    // Legal moves of this piece, including every promotion choice.
+    MoveList getValidMoves(const Position& position) const {
+        PROFILE_SCOPE("getValidMoves");
+        MoveList moves, validMoves;
+        generateLegalMoves(position, moves);
+        for (Move move : moves) {
+            if (move.from() == square()) {
+                validMoves.add(move);
+            }
+        }
+        return validMoves;
+    }
+
+    // Sprites are shared, a piece only queues its square in the atlas batch.
+    void render(TextureAtlas& atlas) const {
+        SDL_Rect dstrect = { m_x * m_size, m_y * m_size, m_size, m_size };
+        atlas.queue(makePiece(m_isWhite ? WHITE : BLACK, getType()), dstrect);
+    }
+
+    int getX() const { return m_x; }
+    int getY() const { return m_y; }
+    bool isWhite() const { return m_isWhite; }
+
+    void setPosition(int x, int y) {
+        m_x = x;
+        m_y = y;
+    }
+};
+
+class Pawn : public Piece {
+public:
+    Pawn(int x, int y, int size, bool isWhite)
+        : Piece(x, y, size, isWhite) {}
+
+    PieceType getType() const override { return PAWN; }
+};
+
+class Rook : public Piece {
+public:
+    Rook(int x, int y, int size, bool isWhite)
+        : Piece(x, y, size, isWhite) {}
+
+    PieceType getType() const override { return ROOK; }
+};
+
+class Knight : public Piece {
+public:
+    Knight(int x, int y, int size, bool isWhite)
+        : Piece(x, y, size, isWhite) {}
+
+    PieceType getType() const override { return KNIGHT; }
+};
+
+class Bishop : public Piece {
+public:
+    Bishop(int x, int y, int size, bool isWhite)
+        : Piece(x, y, size, isWhite) {}
+
+    PieceType getType() const override { return BISHOP; }
+};
+
+class Queen : public Piece {
+public:
+    Queen(int x, int y, int size, bool isWhite)
+        : Piece(x, y, size, isWhite) {}
+
+    PieceType getType() const override { return QUEEN; }
+};
+
+class King : public Piece {
+public:
+    King(int x, int y, int size, bool isWhite)
+        : Piece(x, y, size, isWhite) {}
+
+    PieceType getType() const override { return KING; }
+};
+
+const int IdleTimeoutMs = 500;  // Longest sleep of the event loop
+const int OverlayFrames = 120;  // Frame times the overlay shows
+
+// The main game Class.
+
+class Game {
+private:
+    SDL_Window* m_window;
+    SDL_Renderer* m_renderer;
+    bool m_isRunning;
+    Position m_position;
+    UndoStack m_undo;
+    std::unordered_map<uint64_t, int> m_repetitions;  // Occurrences of each key since the last irreversible move
+    // The window shows standard chess, other geometries only run headless
+    typedef StandardBoard BoardGeometry;
+    static constexpr int Columns = BoardGeometry::Width;
+    static constexpr int Rows = BoardGeometry::Height;
+    static constexpr int CellSize = 600 / (Columns > Rows ? Columns : Rows);
+
+    Piece* m_board[Columns * Rows];  // Sprites indexed by y * Columns + x
+    Piece* m_selectedPiece;
+    MoveList m_validMoves;
+    TextureAtlas m_atlas;
+    SDL_Texture* m_frame;  // Last drawn board, frames only redraw the dirty squares into it
+    Bitboard m_dirty;      // Squares to redraw, indexed like the Position
+    int m_checkSquare;     // King of the side to move if it is in check, cached per position
+    std::unique_ptr<EngineThread> m_engine;  // Searches off the event loop, only when the computer plays
+    Uint32 m_engineEvent;  // SDL event the engine thread pushes when it has a report
+    uint32_t m_searchId;   // Request whose move the game waits for, 0 if none
+    uint32_t m_ponderId;   // Search on the human's time, 0 if none
+    Move m_ponderMove;     // The human move that search expects
+    EngineReport m_ponderResult;
+    bool m_hasPonderResult;  // The ponder search ended before the human moved
+    OpeningBook m_book;
+    std::mt19937 m_random;  // Picks between book moves
+    bool m_engineSide[2];  // Which colors the computer plays
+    int m_engineMoveTime;
+    int m_engineThreads;
+    bool m_overlay;        // Frame time graph, toggled with F3
+    uint64_t m_statsInterval;  // Nanoseconds between profiler dumps to stderr, 0 for none
+    uint64_t m_lastStats;
+    JournalWriter m_journal;  // Records the game move by move when open
+
+public:
+    Game()
+        : m_window(nullptr), m_renderer(nullptr), m_isRunning(true), m_board{}, m_selectedPiece(nullptr),
+          m_frame(nullptr), m_dirty(0), m_checkSquare(NO_SQUARE), m_engineEvent(0), m_searchId(0), m_ponderId(0), m_ponderMove(Move::none()), m_hasPonderResult(false),
+          m_random(std::random_device()()), m_engineSide{ false, false }, m_engineMoveTime(1000), m_engineThreads(1),
+          m_overlay(false), m_statsInterval(0), m_lastStats(0) {}
+
+    ~Game() {
+        m_engine.reset();  // Its notify callback pushes SDL events
+        for (auto& piece : m_board) {
+            delete piece;
+        }
+        m_atlas.release();
+        SDL_DestroyTexture(m_frame);
+        SDL_DestroyRenderer(m_renderer);
+        SDL_DestroyWindow(m_window);
+        IMG_Quit();
+        SDL_Quit();
+    }
+
+    // software picks SDL's software renderer, for headless runs with the
+    // dummy video driver.
+    bool init(bool software = false) {
+        if (SDL_Init(SDL_INIT_VIDEO) < 0) {
+            std::cerr << "SDL could not initialize! SDL_Error: " << SDL_GetError() << std::endl;
+            return false;
+        }
+
+        if (!IMG_Init(IMG_INIT_PNG)) {
+            std::cerr << "SDL_image could not initialize! SDL_image Error: " << IMG_GetError() << std::endl;
+            return false;
+        }
+
+        m_window = SDL_CreateWindow("Chess Game", SDL_WINDOWPOS_UNDEFINED, SDL_WINDOWPOS_UNDEFINED, Columns * CellSize, Rows * CellSize, SDL_WINDOW_SHOWN);
+        if (m_window == nullptr) {
+            std::cerr << "Window could not be created! SDL_Error: " << SDL_GetError() << std::endl;
+            return false;
+        }
+
+        m_renderer = SDL_CreateRenderer(m_window, -1, (software ? SDL_RENDERER_SOFTWARE : SDL_RENDERER_ACCELERATED) | SDL_RENDERER_TARGETTEXTURE);
+        if (m_renderer == nullptr) {
+            std::cerr << "Renderer could not be created! SDL_Error: " << SDL_GetError() << std::endl;
+            return false;
+        }
+
+        if (!m_atlas.load(m_renderer)) {
+            return false;
+        }
+        // Without render targets every frame redraws the whole board
+        m_frame = SDL_CreateTexture(m_renderer, SDL_PIXELFORMAT_RGBA8888, SDL_TEXTUREACCESS_TARGET,
+                                    Columns * CellSize, Rows * CellSize);
+        loadPieces();
+
+        if (m_engineSide[WHITE] || m_engineSide[BLACK]) {
+            m_engineEvent = SDL_RegisterEvents(1);
+            Uint32 event = m_engineEvent;
+            m_engine.reset(new EngineThread(64, m_engineThreads, [event] {
+                SDL_Event e;
+                SDL_zero(e);
+                e.type = event;
+                SDL_PushEvent(&e);
+            }));
+        }
+        return true;
+    }
+
+    Piece* createPiece(int piece, int x, int y) {
+        bool isWhite = pieceColor(piece) == WHITE;
+        switch (pieceType(piece)) {
+            case PAWN: return new Pawn(x, y, CellSize, isWhite);
+            case KNIGHT: return new Knight(x, y, CellSize, isWhite);
+            case BISHOP: return new Bishop(x, y, CellSize, isWhite);
+            case ROOK: return new Rook(x, y, CellSize, isWhite);
+            case QUEEN: return new Queen(x, y, CellSize, isWhite);
+            case KING: return new King(x, y, CellSize, isWhite);
+        }
+        return nullptr;
+    }
+
+    static int spriteKind(const Piece* piece) {
+        return makePiece(piece->isWhite() ? WHITE : BLACK, piece->getType());
+    }
+
+    // Brings the sprites in line with m_position. Sprites that left their
+    // square are reused where a piece of the same kind appeared, so a move
+    // never allocates for the piece that moved. Returns the squares whose
+    // sprite changed.
+    Bitboard syncPieces() {
+        Bitboard changed = 0;
+        std::vector<Piece*> spare;
+        for (int y = 0; y < Rows; ++y) {
+            for (int x = 0; x < Columns; ++x) {
+                Piece*& sprite = m_board[y * Columns + x];
+                if (sprite && spriteKind(sprite) != m_position.pieceOn(makeSquare(x, y))) {
+                    spare.push_back(sprite);
+                    sprite = nullptr;
+                    changed |= squareBB(makeSquare(x, y));
+                }
+            }
+        }
+        for (int y = 0; y < Rows; ++y) {
+            for (int x = 0; x < Columns; ++x) {
+                int piece = m_position.pieceOn(makeSquare(x, y));
+                Piece*& sprite = m_board[y * Columns + x];
+                if (piece == NO_PIECE || sprite) {
+                    continue;
+                }
+                changed |= squareBB(makeSquare(x, y));
+                auto it = std::find_if(spare.begin(), spare.end(), [piece](Piece* p) { return spriteKind(p) == piece; });
+                if (it != spare.end()) {
+                    sprite = *it;
+                    sprite->setPosition(x, y);
+                    spare.erase(it);
+                } else {
+                    sprite = createPiece(piece, x, y);
+                }
+            }
+        }
+        for (Piece* piece : spare) {
+            delete piece;
+        }
+        return changed;
+    }
+
+    void loadPieces() {
+        m_position.setStartPosition();
+        resetBoard();
+    }
+
+    // Starts over from fen, false if it is not a valid position.
+    bool setPosition(const std::string& fen) {
+        if (!m_position.setFromFen(fen)) {
+            return false;
+        }
+        m_isRunning = true;
+        resetBoard();
+        return true;
+    }
+
+    // Forgets the history and selection of the previous position.
+    void resetBoard() {
+        m_undo.clear();
+        m_selectedPiece = nullptr;
+        m_validMoves.clear();
+        m_repetitions.clear();
+        m_repetitions[m_position.key()] = 1;
+        syncPieces();
+        updateCheck();
+        m_dirty = ~Bitboard(0);
+    }
+
+    // The only king that can be in check is the one of the side to move.
+    void updateCheck() {
+        if (m_checkSquare != NO_SQUARE) {
+            m_dirty |= squareBB(m_checkSquare);
+        }
+        m_checkSquare = m_position.checkers() ? m_position.kingSquare(m_position.sideToMove()) : NO_SQUARE;
+        if (m_checkSquare != NO_SQUARE) {
+            m_dirty |= squareBB(m_checkSquare);
+        }
+    }
+
+    Bitboard highlightSquares() const {
+        Bitboard squares = 0;
+        for (Move move : m_validMoves) {
+            squares |= squareBB(move.to());
+        }
+        return squares;
+    }
+
+    void setEngine(bool playsWhite, bool playsBlack, int moveTimeMs, int threads) {
+        m_engineSide[WHITE] = playsWhite;
+        m_engineSide[BLACK] = playsBlack;
+        m_engineMoveTime = moveTimeMs;
+        m_engineThreads = threads;
+    }
+
+    // Records the game in path from now on. If its last game is unfinished,
+    // cut short by a crash or by closing the window, it is played back and
+    // continued, otherwise a new game starts. False if path is not a journal
+    // or cannot be written.
+    bool openJournal(const std::string& path) {
+        size_t keep = SIZE_MAX;
+        bool resumed = false;
+        JournalReader reader;
+        if (reader.open(path)) {
+            JournalGame game = {}, last = {};
+            while (reader.next(game)) {
+                last = game;
+            }
+            if (reader.corrupt()) {
+                keep = reader.offset();  // A game header torn by a crash
+            }
+            if (last.moves && !last.finished) {
+                keep = last.offset;  // Dropped unless it can be played back
+                resumed = last.fen.empty() ? (loadPieces(), true) : setPosition(std::string(last.fen));
+                if (resumed) {
+                    int ply = 0;
+                    MoveList legal;
+                    for (; ply < last.plies && m_isRunning; ++ply) {
+                        generateLegalMoves(m_position, legal);
+                        if (!legal.contains(last.move(ply))) {
+                            break;
+                        }
+                        commitMove(last.move(ply));
+                    }
+                    keep = last.end - 2 * size_t(last.plies - ply);
+                } else {
+                    loadPieces();
+                }
+            }
+        } else if (std::ifstream(path).good()) {
+            return false;  // Something else, not ours to append to
+        }
+        if (!m_journal.open(path, keep)) {
+            return false;
+        }
+        if (resumed && !m_isRunning) {
+            // Its last move was written but not its end
+            m_journal.endGame(finalResult());
+            m_isRunning = true;
+            loadPieces();
+            resumed = false;
+        }
+        if (!resumed) {
+            m_journal.beginGame(m_position, players(), int64_t(std::time(nullptr)));
+        }
+        return true;
+    }
+
+    uint8_t players() const {
+        return uint8_t((m_engineSide[WHITE] ? JournalGame::WHITE_ENGINE : 0) | (m_engineSide[BLACK] ? JournalGame::BLACK_ENGINE : 0));
+    }
+
+    // Result of a game that just ended: mated, or drawn by stalemate or repetition.
+    JournalGame::Result finalResult() const {
+        if (!m_position.checkers() || hasLegalMove(m_position)) {
+            return JournalGame::DRAW;
+        }
+        return m_position.sideToMove() == WHITE ? JournalGame::BLACK_WINS : JournalGame::WHITE_WINS;
+    }
+
+    void setStatsInterval(int seconds) {
+        m_statsInterval = uint64_t(std::max(0, seconds)) * 1000000000;
+    }
+
+    bool loadBook(const std::string& path) {
+        return m_book.open(path);
+    }
+
+    // Sleeps in SDL_WaitEventTimeout until there is input or an engine
+    // report, an idle board costs no CPU and a frame is only drawn when a
+    // square changed. The engine never blocks the loop.
+    void run() {
+        while (m_isRunning) {
+            handleEvents();
+            if (m_isRunning && m_engine && m_engineSide[m_position.sideToMove()] && !m_searchId) {
+                startEngineMove();
+            }
+            render();
+            if (!m_isRunning) {
+                break;
+            }
+            if (m_statsInterval && Profiler::now() - m_lastStats >= m_statsInterval) {
+                m_lastStats = Profiler::now();
+                std::cerr << Profiler::stats() << std::endl;
+            }
+            SDL_Event e;
+            if (SDL_WaitEventTimeout(&e, IdleTimeoutMs)) {
+                handleEvent(e);
+            }
+        }
+    }
+
+    // Keys of the positions since the last irreversible move, for the search's repetition check.
+    std::vector<uint64_t> gameHistory() const {
+        std::vector<uint64_t> keys;
+        for (int i = 0; i < m_undo.size(); ++i) {
+            keys.push_back(m_undo[i].key);
+        }
+        return keys;
+    }
+
+    // Plays a book move or asks the engine thread for a move.
+    void startEngineMove() {
+        Move move = m_book.isOpen() ? m_book.probe(m_position, uint32_t(m_random())) : Move::none();
+        if (move != Move::none()) {
+            commitMove(move);
+            return;
+        }
+        SearchLimits limits;
+        limits.moveTime = m_engineMoveTime;
+        m_searchId = m_engine->post(m_position, gameHistory(), limits);
+    }
+
+    void pollEngine() {
+        EngineReport report;
+        while (m_engine->poll(report)) {
+            if (report.id == m_searchId) {
+                if (report.kind == EngineReport::INFO) {
+                    showEngineInfo(report, "thinking");
+                } else {
+                    playEngineResult(report);
+                }
+            } else if (report.id == m_ponderId) {
+                if (report.kind == EngineReport::INFO) {
+                    showEngineInfo(report, "pondering");
+                } else {
+                    // Kept until the human moves, it only counts if they play the expected move
+                    m_ponderResult = report;
+                    m_hasPonderResult = true;
+                }
+            }
+        }
+    }
+
+    void playEngineResult(const EngineReport& report) {
+        m_searchId = 0;
+        if (report.pvLength == 0) {
+            return;
+        }
+        commitMove(report.pv[0]);
+        if (report.pvLength > 1) {
+            startPondering(report.pv[1]);
+        }
+    }
+
+    // Searches the position after the human's expected reply while they think.
+    void startPondering(Move expected) {
+        if (!m_isRunning || m_engineSide[m_position.sideToMove()]) {
+            return;
+        }
+        MoveList moves;
+        generateLegalMoves(m_position, moves);
+        if (std::find(moves.begin(), moves.end(), expected) == moves.end()) {
+            return;
+        }
+        std::vector<uint64_t> history = gameHistory();
+        history.push_back(m_position.key());
+        Position position = m_position;
+        UndoRecord undo;
+        position.makeMove(expected, undo);
+        SearchLimits limits;
+        limits.moveTime = m_engineMoveTime;
+        limits.ponder = true;
+        m_ponderId = m_engine->post(position, history, limits);
+        m_ponderMove = expected;
+        m_hasPonderResult = false;
+    }
+
+    // After the human's move: the ponder search becomes the engine's search
+    // if they played the expected move, otherwise it is thrown away.
+    void resolvePonder(Move move) {
+        if (!m_ponderId) {
+            return;
+        }
+        uint32_t id = m_ponderId;
+        m_ponderId = 0;
+        if (move != m_ponderMove || !m_isRunning) {
+            m_engine->stop();
+        } else if (m_hasPonderResult) {
+            playEngineResult(m_ponderResult);
+        } else {
+            m_searchId = id;
+            m_engine->ponderhit(id);
+        }
+    }
+
+    void showEngineInfo(const EngineReport& report, const char* state) {
+        std::string title = std::string("Chess Game - ") + state + ", depth " + std::to_string(report.depth) +
+                            " score " + std::to_string(report.score) + " pv";
+        for (int i = 0; i < report.pvLength; ++i) {
+            title += " " + moveToString(report.pv[i]);
+        }
+        SDL_SetWindowTitle(m_window, title.c_str());
+    }
+
+    void handleEvents() {
+        PROFILE_SCOPE("handleEvents");
+        SDL_Event e;
+        while (SDL_PollEvent(&e) != 0) {
+            handleEvent(e);
+        }
+    }
+
+    void handleEvent(const SDL_Event& e) {
+        if (e.type == SDL_QUIT) {
+            m_isRunning = false;
+        } else if (e.type == SDL_MOUSEBUTTONDOWN) {
+            int x, y;
+            SDL_GetMouseState(&x, &y);
+            handleClick(x / CellSize, y / CellSize);
+        } else if (e.type == SDL_KEYDOWN && e.key.keysym.sym == SDLK_F3) {
+            m_overlay = !m_overlay;
+            m_dirty = ~Bitboard(0);  // Clears the graph off the board
+        } else if (m_engine && e.type == m_engineEvent) {
+            pollEngine();
+        } else if (e.type == SDL_RENDER_TARGETS_RESET ||
+                   (e.type == SDL_WINDOWEVENT && e.window.event == SDL_WINDOWEVENT_EXPOSED)) {
+            m_dirty = ~Bitboard(0);
+        }
+    }
+
+    bool isWhiteTurn() const {
+        return m_position.sideToMove() == WHITE;
+    }
+
+    bool isKingInCheck(bool isWhiteKing) {
+        return m_position.isKingInCheck(isWhiteKing ? WHITE : BLACK);
+    }
+
+    bool isCheckmate(bool isWhiteKing) {
+        return isWhiteTurn() == isWhiteKing && isKingInCheck(isWhiteKing) && !hasLegalMove(m_position);
+    }
+
+    bool isStalemate(bool isWhiteKing) {
+        return isWhiteTurn() == isWhiteKing && !isKingInCheck(isWhiteKing) && !hasLegalMove(m_position);
+    }
+
+    // The selected piece's move to (x, y), promotions always pick the queen.
+    Move findValidMove(int x, int y) const {
+        for (Move move : m_validMoves) {
+            if (move.to() == makeSquare(x, y) && (!move.isPromotion() || move.promotion() == QUEEN)) {
+                return move;
+            }
+        }
+        return Move::none();
+    }
+
+    // Plays a legal move on the game and checks whether it ended the game.
+    void commitMove(Move move) {
+        bool isWhite = isWhiteTurn();
+        m_position.makeMove(move, m_undo);
+        m_dirty |= highlightSquares();
+        m_selectedPiece = nullptr;
+        m_validMoves.clear();
+        // Only the reversible tail of the game is kept, a capture or
+        // pawn move makes everything before it unreachable.
+        if (m_position.halfmoveClock() == 0 || m_undo.full()) {
+            m_undo.clear();
+            m_repetitions.clear();
+        }
+        int occurrences = ++m_repetitions[m_position.key()];
+        if (m_journal.isOpen()) {
+            m_journal.appendMove(move);
+        }
+        m_dirty |= syncPieces();
+        updateCheck();
+
+        // Check if the move ended the game
+        if (isCheckmate(!isWhite) || isStalemate(!isWhite) || occurrences >= 3) {
+            // End the game
+            m_isRunning = false;
+            if (m_journal.isOpen()) {
+                m_journal.endGame(finalResult());
+            }
+            // Optionally, display a message indicating checkmate, stalemate or repetition
+        }
+    }
+
+    void handleClick(int x, int y) {
+        PROFILE_SCOPE("handleClick");
+        if (m_engineSide[m_position.sideToMove()]) {
+            return;  // Not the human's turn
+        }
+        if (m_selectedPiece) {
+            Move move = findValidMove(x, y);
+            if (move != Move::none()) {
+                // The valid moves are strictly legal, nothing to try and take back
+                commitMove(move);
+                resolvePonder(move);
+            } else {
+                m_dirty |= highlightSquares();
+                m_selectedPiece = nullptr;
+                m_validMoves.clear();
+            }
+        } else if (m_board[y * Columns + x] && m_board[y * Columns + x]->isWhite() == isWhiteTurn()) {
+            m_selectedPiece = m_board[y * Columns + x];
+            m_validMoves = m_selectedPiece->getValidMoves(m_position);
+            m_dirty |= highlightSquares();
+        }
+    }
+
+    // Redraws every square on the next render.
+    void invalidate() {
+        m_dirty = ~Bitboard(0);
+    }
+
+    void render() {
+        PROFILE_SCOPE("render");
+        // The overlay is drawn over the finished frame, so with it on every
+        // loop presents even if no square changed
+        if (!m_dirty && !m_overlay) {
+            return;
+        }
+        if (m_frame) {
+            SDL_SetRenderTarget(m_renderer, m_frame);
+        } else {
+            m_dirty = ~Bitboard(0);  // The back buffer does not survive a present
+        }
+
+        // Dirty squares, one fill call per color, then their overlays and
+        // pieces from the atlas in a single batch
+        SDL_Rect cells[2][64];
+        int cellCount[2] = { 0, 0 };
+        Bitboard highlights = highlightSquares();
+        for (Bitboard dirty = m_dirty; dirty; ) {
+            int sq = popLsb(dirty);
+            int x = squareX(sq), y = squareY(sq);
+            SDL_Rect cell = { x * CellSize, y * CellSize, CellSize, CellSize };
+            int shade = (x + y) % 2;
+            cells[shade][cellCount[shade]++] = cell;
+            if (sq == m_checkSquare || (highlights & squareBB(sq))) {
+                m_atlas.queue(SPRITE_HIGHLIGHT, cell);
+            }
+            if (Piece* piece = m_board[y * Columns + x]) {
+                piece->render(m_atlas);
+            }
+        }
+        SDL_SetRenderDrawColor(m_renderer, 240, 217, 181, 255);  // Light brown
+        SDL_RenderFillRects(m_renderer, cells[0], cellCount[0]);
+        SDL_SetRenderDrawColor(m_renderer, 181, 136, 99, 255);  // Dark brown
+        SDL_RenderFillRects(m_renderer, cells[1], cellCount[1]);
+        m_atlas.flush();
+        m_dirty = 0;
+
+        if (m_frame) {
+            SDL_SetRenderTarget(m_renderer, nullptr);
+            SDL_RenderCopy(m_renderer, m_frame, nullptr, nullptr);
+        }
+        if (m_overlay) {
+            drawOverlay();
+        }
+        SDL_RenderPresent(m_renderer);
+    }
+
+    // Bars of the last frame times along the bottom edge, 4 px per
+    // millisecond, red above the 60 fps budget marked by the white line.
+    void drawOverlay() {
+        uint64_t durations[OverlayFrames];
+        int count = Profiler::recent("render", durations, OverlayFrames);
+        int bottom = Rows * CellSize;
+        SDL_Rect background = { 0, bottom - 100, OverlayFrames * 3, 100 };
+        SDL_SetRenderDrawBlendMode(m_renderer, SDL_BLENDMODE_BLEND);
+        SDL_SetRenderDrawColor(m_renderer, 0, 0, 0, 160);
+        SDL_RenderFillRect(m_renderer, &background);
+        SDL_Rect bars[2][OverlayFrames];
+        int barCount[2] = { 0, 0 };
+        for (int i = 0; i < count; ++i) {
+            int height = int(std::min<uint64_t>(durations[i] * 4 / 1000000, 100));
+            bool slow = durations[i] > 16666667;
+            bars[slow][barCount[slow]++] = { i * 3, bottom - std::max(height, 1), 2, std::max(height, 1) };
+        }
+        SDL_SetRenderDrawColor(m_renderer, 80, 220, 80, 255);
+        SDL_RenderFillRects(m_renderer, bars[0], barCount[0]);
+        SDL_SetRenderDrawColor(m_renderer, 230, 60, 60, 255);
+        SDL_RenderFillRects(m_renderer, bars[1], barCount[1]);
+        SDL_Rect budget = { 0, bottom - 67, OverlayFrames * 3, 1 };
+        SDL_SetRenderDrawColor(m_renderer, 255, 255, 255, 255);
+        SDL_RenderFillRect(m_renderer, &budget);
+        SDL_SetRenderDrawBlendMode(m_renderer, SDL_BLENDMODE_NONE);
+    }
+};
+
+#endif
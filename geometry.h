@@ -0,0 +1,185 @@
+// Board geometry as a compile-time parameter, for variants on boards other
+// than 8x8.
+//
+// Geometry<Width, Height> numbers squares from a1 = 0 rank by rank, like the
+// Position does, and picks the smallest board type that holds every square:
+// a 64-bit Bitboard up to 64 squares, a 128-bit one up to 128 (10x8
+// Capablanca, 10x10). Its step and ray attack tables are built by constexpr
+// code, so each geometry costs no start-up work and no runtime size checks.
+// Geometry<8, 8> is specialised onto the magic tables of bitboard.h, so code
+// templated on the geometry runs on standard chess at full speed.
+
+#ifndef GEOMETRY_H
+#define GEOMETRY_H
+
+#include "bitboard.h"
+#include <cstdint>
+#include <type_traits>
+
+typedef unsigned __int128 Bitboard128;
+
+inline int popCount(Bitboard128 b) {
+    return __builtin_popcountll(uint64_t(b)) + __builtin_popcountll(uint64_t(b >> 64));
+}
+
+inline int lsb(Bitboard128 b) {
+    return uint64_t(b) ? __builtin_ctzll(uint64_t(b)) : 64 + __builtin_ctzll(uint64_t(b >> 64));
+}
+
+inline int msb(Bitboard b) {
+    return 63 - __builtin_clzll(b);
+}
+
+inline int msb(Bitboard128 b) {
+    return uint64_t(b >> 64) ? 127 - __builtin_clzll(uint64_t(b >> 64)) : 63 - __builtin_clzll(uint64_t(b));
+}
+
+inline int popLsb(Bitboard128& b) {
+    int sq = lsb(b);
+    b &= b - 1;
+    return sq;
+}
+
+// Ray directions. The first four step to higher square numbers, so the
+// nearest blocker on them is the lowest set bit, on the others the highest.
+// Opposite directions are four apart.
+enum Direction { NORTH, EAST, NORTH_EAST, NORTH_WEST, SOUTH, WEST, SOUTH_WEST, SOUTH_EAST, DIRECTION_COUNT };
+
+template <int W, int H>
+struct Geometry {
+    static_assert(W >= 5 && H >= 5 && W * H <= 128, "Boards from 5x5 up to 128 squares");
+
+    static constexpr int Width = W;
+    static constexpr int Height = H;
+    static constexpr int Squares = W * H;
+    typedef typename std::conditional<Squares <= 64, Bitboard, Bitboard128>::type Board;
+
+    static constexpr int square(int file, int rank) { return rank * W + file; }
+    static constexpr int file(int sq) { return sq % W; }
+    static constexpr int rank(int sq) { return sq / W; }
+    static constexpr Board bit(int sq) { return Board(1) << sq; }
+    static constexpr bool onBoard(int file, int rank) { return file >= 0 && file < W && rank >= 0 && rank < H; }
+
+    static constexpr Board rankMask(int rank) {
+        Board mask = 0;
+        for (int file = 0; file < W; ++file) {
+            mask |= bit(square(file, rank));
+        }
+        return mask;
+    }
+
+    struct Tables {
+        Board knight[Squares];
+        Board king[Squares];
+        Board pawn[2][Squares];
+        Board rays[DIRECTION_COUNT][Squares];  // Up to the edge, the square itself excluded
+    };
+
+    static constexpr Board steps(int sq, const int (*offsets)[2], int count) {
+        Board attacks = 0;
+        for (int i = 0; i < count; ++i) {
+            int f = file(sq) + offsets[i][0], r = rank(sq) + offsets[i][1];
+            if (onBoard(f, r)) {
+                attacks |= bit(square(f, r));
+            }
+        }
+        return attacks;
+    }
+
+    static constexpr Tables buildTables() {
+        constexpr int Knight[8][2] = { { 1, 2 }, { 2, 1 }, { 2, -1 }, { 1, -2 }, { -1, -2 }, { -2, -1 }, { -2, 1 }, { -1, 2 } };
+        constexpr int King[8][2] = { { 0, 1 }, { 1, 1 }, { 1, 0 }, { 1, -1 }, { 0, -1 }, { -1, -1 }, { -1, 0 }, { -1, 1 } };
+        constexpr int WhitePawn[2][2] = { { -1, 1 }, { 1, 1 } };
+        constexpr int BlackPawn[2][2] = { { -1, -1 }, { 1, -1 } };
+        constexpr int Rays[DIRECTION_COUNT][2] = { { 0, 1 }, { 1, 0 }, { 1, 1 }, { -1, 1 }, { 0, -1 }, { -1, 0 }, { -1, -1 }, { 1, -1 } };
+        Tables tables = {};
+        for (int sq = 0; sq < Squares; ++sq) {
+            tables.knight[sq] = steps(sq, Knight, 8);
+            tables.king[sq] = steps(sq, King, 8);
+            tables.pawn[WHITE][sq] = steps(sq, WhitePawn, 2);
+            tables.pawn[BLACK][sq] = steps(sq, BlackPawn, 2);
+            for (int d = 0; d < DIRECTION_COUNT; ++d) {
+                for (int f = file(sq) + Rays[d][0], r = rank(sq) + Rays[d][1]; onBoard(f, r); f += Rays[d][0], r += Rays[d][1]) {
+                    tables.rays[d][sq] |= bit(square(f, r));
+                }
+            }
+        }
+        return tables;
+    }
+
+    static constexpr Tables tables = buildTables();
+
+    static Board knightAttacks(int sq) { return tables.knight[sq]; }
+    static Board kingAttacks(int sq) { return tables.king[sq]; }
+    static Board pawnAttacks(Color c, int sq) { return tables.pawn[c][sq]; }
+
+    // The ray from sq cut after its first blocker.
+    static Board rayAttacks(Direction d, int sq, Board occupied) {
+        Board ray = tables.rays[d][sq];
+        Board blockers = ray & occupied;
+        if (blockers) {
+            ray ^= tables.rays[d][d < SOUTH ? lsb(blockers) : msb(blockers)];
+        }
+        return ray;
+    }
+
+    static Board bishopAttacks(int sq, Board occupied) {
+        return rayAttacks(NORTH_EAST, sq, occupied) | rayAttacks(NORTH_WEST, sq, occupied)
+             | rayAttacks(SOUTH_EAST, sq, occupied) | rayAttacks(SOUTH_WEST, sq, occupied);
+    }
+
+    static Board rookAttacks(int sq, Board occupied) {
+        return rayAttacks(NORTH, sq, occupied) | rayAttacks(EAST, sq, occupied)
+             | rayAttacks(SOUTH, sq, occupied) | rayAttacks(WEST, sq, occupied);
+    }
+
+    // Squares strictly between a and b if they share a line, otherwise 0.
+    static Board between(int a, int b) {
+        for (int d = 0; d < DIRECTION_COUNT; ++d) {
+            if (tables.rays[d][a] & bit(b)) {
+                return tables.rays[d][a] & ~tables.rays[d][b] & ~bit(b);
+            }
+        }
+        return 0;
+    }
+
+    // The whole line through a and b, edge to edge, if they share one.
+    static Board line(int a, int b) {
+        for (int d = 0; d < DIRECTION_COUNT; ++d) {
+            if (tables.rays[d][a] & bit(b)) {
+                return tables.rays[d][a] | tables.rays[(d + 4) % DIRECTION_COUNT][a] | bit(a);
+            }
+        }
+        return 0;
+    }
+};
+
+// Standard chess: the same squares and the magic lookups the engine uses.
+template <>
+struct Geometry<8, 8> {
+    static constexpr int Width = 8;
+    static constexpr int Height = 8;
+    static constexpr int Squares = 64;
+    typedef Bitboard Board;
+
+    static constexpr int square(int file, int rank) { return rank * 8 + file; }
+    static constexpr int file(int sq) { return sq & 7; }
+    static constexpr int rank(int sq) { return sq >> 3; }
+    static constexpr Board bit(int sq) { return Board(1) << sq; }
+    static constexpr bool onBoard(int file, int rank) { return (file | rank) >= 0 && file < 8 && rank < 8; }
+    static constexpr Board rankMask(int rank) { return RANK_1_BB << (8 * rank); }
+
+    static Board knightAttacks(int sq) { return ::knightAttacks(sq); }
+    static Board kingAttacks(int sq) { return ::kingAttacks(sq); }
+    static Board pawnAttacks(Color c, int sq) { return ::pawnAttacks(c, sq); }
+    static Board bishopAttacks(int sq, Board occupied) { return ::bishopAttacks(sq, occupied); }
+    static Board rookAttacks(int sq, Board occupied) { return ::rookAttacks(sq, occupied); }
+    static Board between(int a, int b) { return betweenBB(a, b); }
+    static Board line(int a, int b) { return lineBB(a, b); }
+};
+
+typedef Geometry<8, 8> StandardBoard;
+typedef Geometry<10, 8> CapablancaBoard;
+typedef Geometry<10, 10> TenByTenBoard;
+
+#endif
@@ -0,0 +1,294 @@
+#include "journal.h"
+#include "movegen.h"
+#include <algorithm>
+#include <cerrno>
+#include <chrono>
+#include <cstring>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+    const char GameMagic[] = "GAME";
+
+    void put16(std::string& out, uint16_t value) {
+        out += char(value & 0xFF);
+        out += char(value >> 8);
+    }
+
+    uint16_t get16(const unsigned char* p) {
+        return uint16_t(p[0] | p[1] << 8);
+    }
+
+    // Copied instead of parsed, so replaying standard games needs no allocation
+    const Position& standardStart() {
+        static const Position start = [] {
+            Position position;
+            position.setStartPosition();
+            return position;
+        }();
+        return start;
+    }
+
+    bool writeAll(int fd, const char* data, size_t size) {
+        while (size > 0) {
+            ssize_t written = ::write(fd, data, size);
+            if (written < 0) {
+                if (errno == EINTR) {
+                    continue;
+                }
+                return false;
+            }
+            data += written;
+            size -= size_t(written);
+        }
+        return true;
+    }
+}
+
+void appendJournalHeader(std::string& out, const Position& start, uint8_t players, int64_t startTime) {
+    static const std::string standardFen = standardStart().toFen();
+    std::string fen = start.toFen();
+    if (fen == standardFen) {
+        fen.clear();
+    }
+    out.append(GameMagic, 4);
+    put16(out, uint16_t(fen.size()));
+    out += char(players);
+    out += char(0);
+    for (int i = 0; i < 8; ++i) {
+        out += char(uint64_t(startTime) >> (8 * i));
+    }
+    out += fen;
+    if (fen.size() % 2) {
+        out += char(0);  // Keeps the moves 2-byte aligned
+    }
+}
+
+void appendJournalMove(std::string& out, Move move) {
+    put16(out, move.raw());
+}
+
+void appendJournalEnd(std::string& out, JournalGame::Result result) {
+    put16(out, Move::none().raw());
+    put16(out, result);
+}
+
+int replayJournalGame(const JournalGame& game, Position& position, UndoStack& undo) {
+    if (game.fen.empty()) {
+        position = standardStart();
+    } else if (!position.setFromFen(std::string(game.fen))) {
+        return -1;
+    }
+    undo.clear();
+    uint64_t baseKey = position.key();
+    int ply = 0;
+    for (; ply < game.plies; ++ply) {
+        Move move = game.move(ply);
+        MoveList legal;
+        generateLegalMoves(position, legal);
+        if (!legal.contains(move)) {
+            break;
+        }
+        if (undo.full()) {
+            // Longer than any real game, only the last stretch is unwound
+            undo.clear();
+            baseKey = position.key();
+        }
+        position.makeMove(move, undo);
+    }
+
+    Position final = position;
+    while (!undo.empty()) {
+        position.unmakeMove(undo);
+    }
+    if (position.key() != baseKey) {
+        return -1;
+    }
+    position = final;
+    return ply;
+}
+
+bool JournalReader::open(const std::string& path) {
+    m_offset = 0;
+    m_corrupt = false;
+    if (!m_file.open(path, MappedFile::SEQUENTIAL)) {
+        return false;
+    }
+    if (m_file.size() == 0) {
+        return true;
+    }
+    if (m_file.size() < size_t(JournalMagicSize) || std::memcmp(m_file.data(), JournalMagic, JournalMagicSize) != 0) {
+        m_file.close();
+        return false;
+    }
+    m_offset = JournalMagicSize;
+    return true;
+}
+
+bool JournalReader::next(JournalGame& game) {
+    const unsigned char* base = reinterpret_cast<const unsigned char*>(m_file.data());
+    size_t size = m_file.size();
+    if (m_offset >= size) {
+        return false;
+    }
+    const unsigned char* header = base + m_offset;
+    if (size - m_offset < size_t(JournalGameHeaderSize) || std::memcmp(header, GameMagic, 4) != 0) {
+        m_corrupt = true;
+        return false;
+    }
+    size_t fenLength = get16(header + 4);
+    size_t movesOffset = m_offset + JournalGameHeaderSize + fenLength + fenLength % 2;
+    if (movesOffset > size) {
+        m_corrupt = true;
+        return false;
+    }
+    game.offset = m_offset;
+    game.fen = std::string_view(reinterpret_cast<const char*>(header) + JournalGameHeaderSize, fenLength);
+    game.players = header[6];
+    uint64_t startTime = 0;
+    for (int i = 0; i < 8; ++i) {
+        startTime |= uint64_t(header[8 + i]) << (8 * i);
+    }
+    game.startTime = int64_t(startTime);
+    game.moves = base + movesOffset;
+
+    // Moves run up to the zero move, a trailing odd byte is a torn write
+    const unsigned char* p = game.moves;
+    const unsigned char* last = base + size - 1;
+    while (p < last && get16(p) != 0) {
+        p += 2;
+    }
+    game.plies = int((p - game.moves) / 2);
+    game.finished = p + 3 < base + size;
+    game.result = game.finished ? JournalGame::Result(std::min<uint16_t>(get16(p + 2), JournalGame::DRAW)) : JournalGame::UNKNOWN;
+    game.end = size_t(p - base) + (game.finished ? 4 : 0);
+    // A game that did not finish ends the journal, anything after it is torn
+    m_offset = game.finished ? game.end : size;
+    return true;
+}
+
+bool JournalWriter::open(const std::string& path, size_t keepBytes, int syncIntervalMs) {
+    close();
+    int fd = ::open(path.c_str(), O_WRONLY | O_CREAT | O_APPEND, 0644);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0 || (size_t(info.st_size) > keepBytes && ftruncate(fd, off_t(keepBytes)) != 0)) {
+        ::close(fd);
+        return false;
+    }
+    if (std::min(size_t(info.st_size), keepBytes) == 0) {
+        if (!writeAll(fd, JournalMagic, JournalMagicSize)) {
+            ::close(fd);
+            return false;
+        }
+    }
+    m_fd = fd;
+    m_syncIntervalMs = std::max(0, syncIntervalMs);
+    m_quit = false;
+    m_failed = false;
+    m_thread = std::thread([this] { loop(); });
+    return true;
+}
+
+void JournalWriter::close() {
+    if (m_fd < 0) {
+        return;
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_quit = true;
+    }
+    m_wake.notify_one();
+    m_thread.join();
+    ::close(m_fd);
+    m_fd = -1;
+}
+
+void JournalWriter::beginGame(const Position& start, uint8_t players, int64_t startTime) {
+    m_encoded.clear();
+    appendJournalHeader(m_encoded, start, players, startTime);
+    push(m_encoded, false);
+}
+
+void JournalWriter::appendMove(Move move) {
+    m_encoded.clear();
+    appendJournalMove(m_encoded, move);
+    push(m_encoded, false);
+}
+
+void JournalWriter::endGame(JournalGame::Result result) {
+    m_encoded.clear();
+    appendJournalEnd(m_encoded, result);
+    push(m_encoded, true);
+}
+
+void JournalWriter::push(const std::string& bytes, bool sync) {
+    if (m_fd < 0) {
+        return;
+    }
+    Block block;
+    for (size_t done = 0; done < bytes.size(); done += block.size) {
+        block.size = uint8_t(std::min(bytes.size() - done, sizeof(block.bytes)));
+        block.sync = sync && done + block.size == bytes.size();
+        std::memcpy(block.bytes, bytes.data() + done, block.size);
+        while (!m_blocks.push(block)) {
+            m_wake.notify_one();
+            std::this_thread::yield();
+        }
+    }
+    {
+        // Taking the mutex orders the push before the writer's empty check
+        std::lock_guard<std::mutex> lock(m_mutex);
+    }
+    m_wake.notify_one();
+}
+
+// Writes blocks as they arrive, batched into one write() per wakeup. An
+// fsync follows the end of a game, otherwise at most one per interval so a
+// fast stream of moves costs one sync per interval instead of one each.
+void JournalWriter::loop() {
+    typedef std::chrono::steady_clock Clock;
+    std::string pending;
+    pending.reserve(64 << 10);
+    Clock::time_point lastSync = Clock::now();
+    bool unsynced = false;
+    for (;;) {
+        bool quit;
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            auto ready = [this] { return m_quit || !m_blocks.empty(); };
+            if (unsynced) {
+                m_wake.wait_until(lock, lastSync + std::chrono::milliseconds(m_syncIntervalMs), ready);
+            } else {
+                m_wake.wait(lock, ready);
+            }
+            quit = m_quit;
+        }
+        bool syncNow = quit;
+        Block block;
+        while (m_blocks.pop(block)) {
+            pending.append(block.bytes, block.size);
+            syncNow |= block.sync;
+        }
+        if (!pending.empty()) {
+            if (!writeAll(m_fd, pending.data(), pending.size())) {
+                m_failed = true;
+            }
+            pending.clear();
+            unsynced = true;
+        }
+        if (unsynced && (syncNow || Clock::now() - lastSync >= std::chrono::milliseconds(m_syncIntervalMs))) {
+            if (fdatasync(m_fd) != 0) {
+                m_failed = true;
+            }
+            lastSync = Clock::now();
+            unsynced = false;
+        }
+        if (quit && m_blocks.empty()) {
+            return;
+        }
+    }
+}
@@ -0,0 +1,140 @@
+// Append-only binary game journal, about two bytes per ply.
+//
+// The file starts with the 8 byte magic "CWOJRNL1" and holds games back to
+// back. A game is a 16 byte header, the start FEN unless it is the standard
+// start (padded to an even length), one Move::raw() per ply and an end
+// marker: a zero move followed by the result. Numbers are little-endian.
+// A game without an end marker is still being played or was cut short by a
+// crash; only the last game can be one and its moves read back normally.
+//
+// JournalWriter encodes on the caller's thread and hands the bytes to a
+// writer thread, which writes them as they come and fsyncs at most every
+// syncIntervalMs and when a game ends. JournalReader maps the file and
+// hands out views into it, replaying a game allocates nothing.
+
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include "mapped_file.h"
+#include "position.h"
+#include "spsc_queue.h"
+#include <atomic>
+#include <condition_variable>
+#include <cstdint>
+#include <mutex>
+#include <string>
+#include <string_view>
+#include <thread>
+
+const char JournalMagic[] = "CWOJRNL1";
+const int JournalMagicSize = 8;
+const int JournalGameHeaderSize = 16;  // "GAME", FEN length, players, reserved, start time
+
+struct JournalGame {
+    enum Result : uint8_t {
+        UNKNOWN,     // Abandoned, or "*" in a converted archive
+        WHITE_WINS,
+        BLACK_WINS,
+        DRAW
+    };
+
+    enum Players : uint8_t {
+        WHITE_ENGINE = 1,  // The computer played white
+        BLACK_ENGINE = 2
+    };
+
+    std::string_view fen;        // Empty for the standard start
+    const unsigned char* moves;  // plies packed moves, points into the mapping
+    int plies;
+    Result result;
+    uint8_t players;
+    int64_t startTime;           // Unix seconds
+    bool finished;               // The end marker was written
+    size_t offset;               // Of the game header in the file
+    size_t end;                  // Past the last complete move or the end marker
+
+    Move move(int ply) const { return Move::fromRaw(uint16_t(moves[2 * ply] | moves[2 * ply + 1] << 8)); }
+};
+
+// Encoders, for writing journals without a JournalWriter.
+void appendJournalHeader(std::string& out, const Position& start, uint8_t players, int64_t startTime);
+void appendJournalMove(std::string& out, Move move);
+void appendJournalEnd(std::string& out, JournalGame::Result result);
+
+// Plays game from its start, checking every move with the legal move
+// generator, then takes the moves back and checks the start key returns.
+// position is left after the last legal move. Returns the number of legal
+// plies (game.plies if all are), -1 if the start FEN does not parse or the
+// moves do not unwind to it. Only a FEN start allocates, to parse it.
+int replayJournalGame(const JournalGame& game, Position& position, UndoStack& undo);
+
+class JournalReader {
+private:
+    MappedFile m_file;
+    size_t m_offset;
+    bool m_corrupt;
+
+public:
+    JournalReader() : m_offset(0), m_corrupt(false) {}
+
+    // Maps path, false if it cannot be opened or is not a journal. An empty
+    // file is a journal without games.
+    bool open(const std::string& path);
+    // Next game, false once the file is used up or a game header is damaged.
+    bool next(JournalGame& game);
+    // next() stopped at a damaged game header instead of the end of the file.
+    bool corrupt() const { return m_corrupt; }
+    // Where the next game starts. Once next() found a damaged header, where
+    // the intact part of the journal ends.
+    size_t offset() const { return m_offset; }
+    size_t size() const { return m_file.size(); }
+};
+
+class JournalWriter {
+private:
+    // Pieces of encoded bytes, so a FEN header needs no allocation either
+    struct Block {
+        uint8_t size;
+        bool sync;  // fsync once this is written
+        char bytes[126];
+    };
+
+    int m_fd;
+    int m_syncIntervalMs;
+    SpscQueue<Block, 1024> m_blocks;
+    std::string m_encoded;           // Caller side scratch
+    std::mutex m_mutex;              // Only for sleeping on m_wake
+    std::condition_variable m_wake;
+    std::atomic<bool> m_quit;        // Set under m_mutex so the writer cannot miss it
+    std::atomic<bool> m_failed;
+    std::thread m_thread;
+
+public:
+    JournalWriter() : m_fd(-1), m_syncIntervalMs(0), m_quit(false), m_failed(false) {}
+    ~JournalWriter() { close(); }
+    JournalWriter(const JournalWriter&) = delete;
+    JournalWriter& operator=(const JournalWriter&) = delete;
+
+    // Opens path for appending and starts the writer thread, writing the
+    // magic if the file is new. Bytes past keepBytes, the torn tail of a
+    // game a crash cut short, are dropped first. False if path cannot be
+    // opened or written.
+    bool open(const std::string& path, size_t keepBytes = SIZE_MAX, int syncIntervalMs = 200);
+    // Writes and syncs whatever is queued and stops the writer thread.
+    void close();
+    bool isOpen() const { return m_fd >= 0; }
+    // A write or fsync failed, later games may be incomplete.
+    bool failed() const { return m_failed.load(std::memory_order_relaxed); }
+
+    // Caller side, one thread only. Never blocks unless the writer thread
+    // has fallen a thousand blocks behind.
+    void beginGame(const Position& start, uint8_t players, int64_t startTime);
+    void appendMove(Move move);
+    void endGame(JournalGame::Result result);
+
+private:
+    void push(const std::string& bytes, bool sync);
+    void loop();
+};
+
+#endif
@@ -0,0 +1,45 @@
+#include "mapped_file.h"
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace {
+    // Stands in for the mapping of an empty file, mmap refuses length 0
+    const char EmptyFile[1] = { 0 };
+}
+
+bool MappedFile::open(const std::string& path, Access access) {
+    close();
+    int fd = ::open(path.c_str(), O_RDONLY);
+    if (fd < 0) {
+        return false;
+    }
+    struct stat info;
+    if (fstat(fd, &info) != 0) {
+        ::close(fd);
+        return false;
+    }
+    if (info.st_size == 0) {
+        ::close(fd);
+        m_data = EmptyFile;
+        return true;
+    }
+    void* data = mmap(nullptr, size_t(info.st_size), PROT_READ, MAP_PRIVATE, fd, 0);
+    ::close(fd);  // The mapping keeps the file alive
+    if (data == MAP_FAILED) {
+        return false;
+    }
+    madvise(data, size_t(info.st_size), access == SEQUENTIAL ? MADV_SEQUENTIAL : MADV_RANDOM);
+    m_data = static_cast<const char*>(data);
+    m_size = size_t(info.st_size);
+    return true;
+}
+
+void MappedFile::close() {
+    if (m_data && m_data != EmptyFile) {
+        munmap(const_cast<char*>(m_data), m_size);
+    }
+    m_data = nullptr;
+    m_size = 0;
+}
@@ -0,0 +1,34 @@
+// Read-only memory mapping of a whole file.
+
+#ifndef MAPPED_FILE_H
+#define MAPPED_FILE_H
+
+#include <cstddef>
+#include <string>
+
+class MappedFile {
+private:
+    const char* m_data;
+    size_t m_size;
+
+public:
+    enum Access {
+        RANDOM,
+        SEQUENTIAL  // Read ahead aggressively and drop pages behind
+    };
+
+    MappedFile() : m_data(nullptr), m_size(0) {}
+    ~MappedFile() { close(); }
+    MappedFile(const MappedFile&) = delete;
+    MappedFile& operator=(const MappedFile&) = delete;
+
+    // Maps path, false if it cannot be opened. An empty file maps to size 0.
+    bool open(const std::string& path, Access access = RANDOM);
+    void close();
+
+    bool isOpen() const { return m_data != nullptr; }
+    const char* data() const { return m_data; }
+    size_t size() const { return m_size; }
+};
+
+#endif
@@ -0,0 +1,868 @@
+// Headless strength testing.
+//
+//   match epd [--threads n] [--nodes n | --movetime ms | --depth n] [--hash MB]
+//             [--nnue file] <suite.epd>
+//   match play --engine1 "<command>" --engine2 "<command>" [--option1 Name=Value]...
+//              [--option2 Name=Value]... [--games n] [--concurrency n]
+//              [--nodes n | --movetime ms | --tc seconds+increment]
+//              [--openings file.epd | --book file.bin [--book-plies n]] [--seed n]
+//              [--sprt elo0 elo1 [alpha beta]] [--resign cp moves]
+//              [--draw ply cp moves] [--max-plies n] [--journal out.cwj]
+//
+// epd solves a test suite with the built-in search on a thread pool: a
+// position counts as solved if the move found is one of its bm moves and
+// none of its am moves. One tab separated line per position in input
+// order (id, solved or failed, the move, the expected moves, depth, nodes),
+// the total to stderr.
+//
+// play runs a match between two UCI engines, typically two builds or two
+// settings of this one ("bin/Release/Chess --uci"). Each opening is played
+// twice with the colours swapped, concurrency games run at once and every
+// move an engine sends is checked by the move generator; an illegal move,
+// a crash or a timeout loses. After every game the score, the Elo
+// difference with its 95% interval and, with --sprt, the log-likelihood
+// ratio are printed; the match stops early once the SPRT accepts either
+// hypothesis. Exit code 0 if H1 (engine1 is at least elo1 stronger) was
+// accepted or no SPRT was run, 2 if H0 was, 3 if the games ran out before
+// the SPRT decided, 1 on errors.
+
+#include "book.h"
+#include "journal.h"
+#include "movegen.h"
+#include "nnue.h"
+#include "notation.h"
+#include "search.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fcntl.h>
+#include <fstream>
+#include <iostream>
+#include <mutex>
+#include <poll.h>
+#include <random>
+#include <sstream>
+#include <string>
+#include <sys/wait.h>
+#include <thread>
+#include <unistd.h>
+#include <utility>
+#include <vector>
+
+namespace {
+    typedef std::chrono::steady_clock Clock;
+
+    int elapsedMs(Clock::time_point since) {
+        return int(std::chrono::duration_cast<std::chrono::milliseconds>(Clock::now() - since).count());
+    }
+
+    std::vector<std::string> split(const std::string& text) {
+        std::istringstream is(text);
+        std::vector<std::string> words;
+        std::string word;
+        while (is >> word) {
+            words.push_back(word);
+        }
+        return words;
+    }
+
+    Move parseUciMove(const Position& position, const std::string& text) {
+        MoveList moves;
+        generateLegalMoves(position, moves);
+        for (Move move : moves) {
+            if (moveToString(move) == text) {
+                return move;
+            }
+        }
+        return Move::none();
+    }
+
+    // An EPD line: the four position fields, optionally the two clocks of
+    // a full FEN, then "opcode operands;" operations.
+    struct Epd {
+        std::string fen;
+        std::string id;
+        std::vector<std::string> bestMoves;   // bm, in SAN
+        std::vector<std::string> avoidMoves;  // am
+    };
+
+    bool parseEpd(const std::string& line, Epd& epd) {
+        std::istringstream is(line);
+        std::string field;
+        for (int i = 0; i < 4 && is >> field; ++i) {
+            epd.fen += (i ? " " : "") + field;
+        }
+        std::streampos operations = is.tellg();
+        int halfmove, fullmove;
+        if (is >> halfmove >> fullmove) {
+            epd.fen += " " + std::to_string(halfmove) + " " + std::to_string(fullmove);
+        } else {
+            is.clear();
+            is.seekg(operations);
+        }
+        std::string rest;
+        std::getline(is, rest);
+        std::istringstream ops(rest);
+        std::string operation;
+        while (std::getline(ops, operation, ';')) {
+            std::vector<std::string> words = split(operation);
+            if (words.empty()) {
+                continue;
+            }
+            if (words[0] == "bm") {
+                epd.bestMoves.assign(words.begin() + 1, words.end());
+            } else if (words[0] == "am") {
+                epd.avoidMoves.assign(words.begin() + 1, words.end());
+            } else if (words[0] == "id" && words.size() > 1) {
+                size_t quote = operation.find('"');
+                epd.id = quote == std::string::npos ? words[1] : operation.substr(quote + 1, operation.rfind('"') - quote - 1);
+            }
+        }
+        Position position;
+        return position.setFromFen(epd.fen);
+    }
+
+    std::vector<std::string> readLines(const std::string& path) {
+        std::ifstream in(path);
+        std::vector<std::string> lines;
+        std::string line;
+        while (std::getline(in, line)) {
+            while (!line.empty() && (line.back() == '\r' || line.back() == ' ')) {
+                line.pop_back();
+            }
+            if (!line.empty() && line[0] != '#') {
+                lines.push_back(line);
+            }
+        }
+        return lines;
+    }
+
+    // --- EPD suites ---
+
+    struct EpdOptions {
+        int threads = 0;
+        int hashMB = 16;
+        SearchLimits limits;
+        std::string nnue;
+    };
+
+    struct EpdResult {
+        bool solved = false;
+        std::string line;
+    };
+
+    int runEpd(const EpdOptions& options, const std::string& path) {
+        std::vector<std::string> lines = readLines(path);
+        if (lines.empty()) {
+            std::cerr << "No positions in " << path << std::endl;
+            return 1;
+        }
+        if (!options.nnue.empty() && !Nnue::load(options.nnue)) {
+            std::cerr << "Cannot load network " << options.nnue << std::endl;
+            return 1;
+        }
+        WorkStealingPool pool(options.threads);
+
+        // A task takes whichever search is idle, there is one per worker
+        struct Engine {
+            TranspositionTable tt;
+            Search search;
+            explicit Engine(int hashMB) : tt(hashMB), search(tt) {}
+        };
+        std::mutex enginesMutex;
+        std::vector<std::unique_ptr<Engine>> engines;
+        for (int i = 0; i < pool.size(); ++i) {
+            engines.emplace_back(new Engine(options.hashMB));
+        }
+
+        auto start = Clock::now();
+        std::vector<EpdResult> results(lines.size());
+        for (size_t i = 0; i < lines.size(); ++i) {
+            pool.submit([&, i] {
+                EpdResult& result = results[i];
+                Epd epd;
+                if (!parseEpd(lines[i], epd) || (epd.bestMoves.empty() && epd.avoidMoves.empty())) {
+                    result.line = std::to_string(i + 1) + "\tbadepd\t" + lines[i];
+                    return;
+                }
+                Position position;
+                position.setFromFen(epd.fen);
+                std::unique_ptr<Engine> engine;
+                {
+                    std::lock_guard<std::mutex> lock(enginesMutex);
+                    engine = std::move(engines.back());
+                    engines.pop_back();
+                }
+                int depth = 0;
+                engine->tt.clear();
+                Move best = engine->search.think(position, options.limits, std::vector<uint64_t>(),
+                                                 [&depth](const SearchInfo& info) { depth = info.depth; });
+                uint64_t nodes = engine->search.nodes();
+                {
+                    std::lock_guard<std::mutex> lock(enginesMutex);
+                    engines.push_back(std::move(engine));
+                }
+
+                bool found = epd.bestMoves.empty();
+                for (const std::string& san : epd.bestMoves) {
+                    found |= parseSan(position, san) == best;
+                }
+                for (const std::string& san : epd.avoidMoves) {
+                    found &= parseSan(position, san) != best;
+                }
+                result.solved = found && best != Move::none();
+                std::string expected;
+                if (!epd.bestMoves.empty()) {
+                    expected = "bm";
+                    for (const std::string& san : epd.bestMoves) {
+                        expected += " " + san;
+                    }
+                }
+                if (!epd.avoidMoves.empty()) {
+                    expected += expected.empty() ? "am" : "; am";
+                    for (const std::string& san : epd.avoidMoves) {
+                        expected += " " + san;
+                    }
+                }
+                result.line = (epd.id.empty() ? std::to_string(i + 1) : epd.id) + (result.solved ? "\tsolved\t" : "\tfailed\t")
+                            + (best == Move::none() ? std::string("none") : moveToSan(position, best)) + '\t' + expected
+                            + '\t' + std::to_string(depth) + '\t' + std::to_string(nodes);
+            });
+        }
+        pool.wait();
+
+        int solved = 0;
+        for (const EpdResult& result : results) {
+            std::cout << result.line << '\n';
+            solved += result.solved;
+        }
+        std::cout.flush();
+        std::cerr << "Solved: " << solved << "/" << results.size() << "  Time: " << elapsedMs(start)
+                  << " ms  Threads: " << pool.size() << std::endl;
+        return 0;
+    }
+
+    // --- Matches ---
+
+    struct EngineSpec {
+        std::vector<std::string> command;
+        std::vector<std::pair<std::string, std::string>> options;
+    };
+
+    // A UCI engine in a child process, talked to through its stdin and stdout.
+    class UciEngine {
+    private:
+        pid_t m_pid;
+        int m_in;   // The engine's stdin
+        int m_out;  // The engine's stdout
+        std::string m_buffer;
+
+    public:
+        std::string name;
+
+        UciEngine() : m_pid(-1), m_in(-1), m_out(-1) {}
+        ~UciEngine() { stop(); }
+        UciEngine(const UciEngine&) = delete;
+        UciEngine& operator=(const UciEngine&) = delete;
+
+        bool running() const { return m_pid > 0; }
+
+        // Starts the engine and waits for uciok and readyok with the options set.
+        bool start(const EngineSpec& spec) {
+            stop();
+            int toEngine[2], fromEngine[2];
+            if (spec.command.empty() || pipe2(toEngine, O_CLOEXEC) != 0) {
+                return false;
+            }
+            if (pipe2(fromEngine, O_CLOEXEC) != 0) {
+                ::close(toEngine[0]);
+                ::close(toEngine[1]);
+                return false;
+            }
+            m_pid = fork();
+            if (m_pid == 0) {
+                dup2(toEngine[0], STDIN_FILENO);
+                dup2(fromEngine[1], STDOUT_FILENO);
+                std::vector<char*> argv;
+                for (const std::string& arg : spec.command) {
+                    argv.push_back(const_cast<char*>(arg.c_str()));
+                }
+                argv.push_back(nullptr);
+                execvp(argv[0], argv.data());
+                _exit(127);
+            }
+            ::close(toEngine[0]);
+            ::close(fromEngine[1]);
+            m_in = toEngine[1];
+            m_out = fromEngine[0];
+            m_buffer.clear();
+            if (m_pid < 0) {
+                stop();
+                return false;
+            }
+
+            name = spec.command[0].substr(spec.command[0].rfind('/') + 1);
+            std::string line;
+            send("uci");
+            while (readLine(line, 10000)) {
+                if (line.compare(0, 8, "id name ") == 0) {
+                    name = line.substr(8);
+                } else if (line == "uciok") {
+                    break;
+                }
+            }
+            if (line != "uciok") {
+                stop();
+                return false;
+            }
+            for (const auto& option : spec.options) {
+                send("setoption name " + option.first + " value " + option.second);
+            }
+            return ready();
+        }
+
+        void stop() {
+            if (m_pid > 0) {
+                send("quit");
+                ::close(m_in);
+                // A second to exit on its own, then it is killed
+                for (int waited = 0; waitpid(m_pid, nullptr, WNOHANG) == 0; ++waited) {
+                    if (waited == 100) {
+                        kill(m_pid, SIGKILL);
+                        waitpid(m_pid, nullptr, 0);
+                        break;
+                    }
+                    std::this_thread::sleep_for(std::chrono::milliseconds(10));
+                }
+                ::close(m_out);
+            }
+            m_pid = -1;
+            m_in = m_out = -1;
+        }
+
+        bool send(const std::string& command) {
+            std::string line = command + '\n';
+            size_t done = 0;
+            while (m_in >= 0 && done < line.size()) {
+                ssize_t written = ::write(m_in, line.data() + done, line.size() - done);
+                if (written < 0 && errno != EINTR) {
+                    return false;
+                }
+                done += written > 0 ? size_t(written) : 0;
+            }
+            return m_in >= 0;
+        }
+
+        // Next line of output, false on end of output or after timeoutMs.
+        bool readLine(std::string& line, int timeoutMs) {
+            auto start = Clock::now();
+            for (;;) {
+                size_t eol = m_buffer.find('\n');
+                if (eol != std::string::npos) {
+                    line = m_buffer.substr(0, eol);
+                    if (!line.empty() && line.back() == '\r') {
+                        line.pop_back();
+                    }
+                    m_buffer.erase(0, eol + 1);
+                    return true;
+                }
+                int left = timeoutMs - elapsedMs(start);
+                if (m_out < 0 || left <= 0) {
+                    return false;
+                }
+                pollfd fd = { m_out, POLLIN, 0 };
+                int ready = ::poll(&fd, 1, left);
+                if (ready < 0 && errno == EINTR) {
+                    continue;
+                } else if (ready <= 0) {
+                    return false;
+                }
+                char chunk[4096];
+                ssize_t received = ::read(m_out, chunk, sizeof(chunk));
+                if (received <= 0) {
+                    return false;
+                }
+                m_buffer.append(chunk, size_t(received));
+            }
+        }
+
+        bool ready() {
+            std::string line;
+            send("isready");
+            while (readLine(line, 10000)) {
+                if (line == "readyok") {
+                    return true;
+                }
+            }
+            return false;
+        }
+    };
+
+    struct MatchOptions {
+        EngineSpec engines[2];
+        int games = 100;
+        int concurrency = 0;
+        uint64_t nodes = 0;
+        int moveTime = 0;
+        int baseMs = 0;  // --tc
+        int incrementMs = 0;
+        std::string openings;
+        std::string book;
+        int bookPlies = 8;
+        uint32_t seed = 1;
+        bool sprt = false;
+        double elo0 = 0, elo1 = 5, alpha = 0.05, beta = 0.05;
+        int resignCp = 0, resignMoves = 0;    // 0: never resign
+        int drawPly = 0, drawCp = 0, drawMoves = 0;  // drawMoves 0: no draw adjudication
+        int maxPlies = 600;
+        std::string journal;
+    };
+
+    // Engine1's results.
+    struct Tally {
+        int wins = 0, draws = 0, losses = 0;
+
+        int games() const { return wins + draws + losses; }
+        double score() const { return games() ? (wins + 0.5 * draws) / games() : 0.5; }
+        // Per game variance of the score
+        double variance() const {
+            double s = score();
+            return games() ? (wins * (1 - s) * (1 - s) + draws * (0.5 - s) * (0.5 - s) + losses * s * s) / games() : 0;
+        }
+    };
+
+    double scoreToElo(double score) {
+        score = std::min(std::max(score, 1e-6), 1 - 1e-6);
+        return -400 * std::log10(1 / score - 1);
+    }
+
+    double eloToScore(double elo) {
+        return 1 / (1 + std::pow(10, -elo / 400));
+    }
+
+    // Difference and half width of its 95% confidence interval.
+    std::pair<double, double> eloEstimate(const Tally& tally) {
+        double s = tally.score();
+        double margin = tally.games() ? 1.959964 * std::sqrt(tally.variance() / tally.games()) : 0.5;
+        return { scoreToElo(s), (scoreToElo(s + margin) - scoreToElo(s - margin)) / 2 };
+    }
+
+    // Log-likelihood ratio of elo1 against elo0, the normal approximation
+    // of the generalised SPRT on the game scores.
+    double logLikelihoodRatio(const Tally& tally, double elo0, double elo1) {
+        double variance = tally.variance();
+        if (tally.games() == 0 || variance <= 0) {
+            return 0;
+        }
+        double s0 = eloToScore(elo0), s1 = eloToScore(elo1);
+        return (s1 - s0) * (2 * tally.score() - s0 - s1) * tally.games() / (2 * variance);
+    }
+
+    struct GameRecord {
+        int result;  // For white: 1, 0 or -1
+        std::string reason;
+        Position start;
+        std::vector<Move> moves;
+    };
+
+    bool insufficientMaterial(const Position& position) {
+        for (Color c : { WHITE, BLACK }) {
+            if (position.pieces(c, PAWN) | position.pieces(c, ROOK) | position.pieces(c, QUEEN)) {
+                return false;
+            }
+        }
+        return popCount(position.occupied()) <= 3;  // Kings and at most one minor piece
+    }
+
+    // Referees one game. engines[0] plays white. Every move is checked
+    // against the legal move list before it is played.
+    GameRecord playGame(UciEngine* engines[2], const Position& start, const MatchOptions& options) {
+        GameRecord record = { 0, "", start, {} };
+        Position position = start;
+        std::vector<uint64_t> keys;
+        std::string moveText;
+        int clock[2] = { options.baseMs, options.baseMs };
+        int lastScore[2] = { 0, 0 };  // Each side's last score, from its own side
+        int resignCount = 0, drawCount = 0;
+        for (UciEngine* engine : { engines[0], engines[1] }) {
+            engine->send("ucinewgame");
+            engine->ready();
+        }
+
+        for (int ply = 0;; ++ply) {
+            if (!hasLegalMove(position)) {
+                record.result = position.checkers() ? (position.sideToMove() == WHITE ? -1 : 1) : 0;
+                record.reason = position.checkers() ? "mate" : "stalemate";
+                return record;
+            }
+            if (position.halfmoveClock() >= 100 || std::count(keys.begin(), keys.end(), position.key()) >= 2
+                || insufficientMaterial(position) || ply >= options.maxPlies) {
+                record.reason = position.halfmoveClock() >= 100 ? "fifty moves"
+                              : insufficientMaterial(position) ? "insufficient material"
+                              : ply >= options.maxPlies ? "max plies" : "repetition";
+                return record;
+            }
+
+            Color us = position.sideToMove();
+            UciEngine& engine = *engines[us];
+            std::string go = "go";
+            int timeoutMs = 60000;
+            if (options.nodes) {
+                go += " nodes " + std::to_string(options.nodes);
+            } else if (options.moveTime) {
+                go += " movetime " + std::to_string(options.moveTime);
+                timeoutMs = options.moveTime * 2 + 5000;
+            } else {
+                go += " wtime " + std::to_string(clock[WHITE]) + " btime " + std::to_string(clock[BLACK])
+                    + " winc " + std::to_string(options.incrementMs) + " binc " + std::to_string(options.incrementMs);
+                timeoutMs = clock[us] + 5000;
+            }
+            engine.send("position fen " + start.toFen() + (moveText.empty() ? "" : " moves" + moveText));
+            engine.send(go);
+            auto thinking = Clock::now();
+
+            std::string line, best;
+            while (best.empty() && engine.readLine(line, timeoutMs - elapsedMs(thinking))) {
+                std::vector<std::string> words = split(line);
+                if (words.size() >= 2 && words[0] == "bestmove") {
+                    best = words[1];
+                }
+                for (size_t i = 0; i + 2 < words.size(); ++i) {
+                    if (words[i] == "score" && words[i + 1] == "cp") {
+                        lastScore[us] = std::atoi(words[i + 2].c_str());
+                    } else if (words[i] == "score" && words[i + 1] == "mate") {
+                        int mate = std::atoi(words[i + 2].c_str());
+                        lastScore[us] = mate > 0 ? 30000 - mate : -30000 - mate;
+                    }
+                }
+            }
+            int used = elapsedMs(thinking);
+            record.result = us == WHITE ? -1 : 1;
+            if (best.empty()) {
+                record.reason = engine.running() && used < timeoutMs ? "crash" : "no reply";
+                engine.stop();  // Restarted before the next game
+                return record;
+            }
+            if (!options.nodes && !options.moveTime) {
+                clock[us] -= used;
+                if (clock[us] < 0) {
+                    record.reason = "time forfeit";
+                    return record;
+                }
+                clock[us] += options.incrementMs;
+            }
+            Move move = parseUciMove(position, best);
+            if (move == Move::none()) {
+                record.reason = "illegal move " + best;
+                return record;
+            }
+            record.result = 0;
+
+            keys.push_back(position.key());
+            UndoRecord undo;
+            position.makeMove(move, undo);
+            if (position.halfmoveClock() == 0) {
+                keys.clear();
+            }
+            record.moves.push_back(move);
+            moveText += " " + best;
+
+            // Adjudication needs both engines to agree, the mover's score against the other's
+            int mover = lastScore[us], other = lastScore[us ^ 1];
+            resignCount = options.resignMoves && mover <= -options.resignCp && other >= options.resignCp ? resignCount + 1 : 0;
+            if (options.resignMoves && resignCount >= 2 * options.resignMoves) {
+                record.result = us == WHITE ? -1 : 1;
+                record.reason = "adjudicated loss";
+                return record;
+            }
+            drawCount = options.drawMoves && ply + 1 >= options.drawPly && std::abs(mover) <= options.drawCp
+                            && std::abs(other) <= options.drawCp ? drawCount + 1 : 0;
+            if (options.drawMoves && drawCount >= 2 * options.drawMoves) {
+                record.reason = "adjudicated draw";
+                return record;
+            }
+        }
+    }
+
+    // Opening k of the match, the same for both games of a pair.
+    class Openings {
+    private:
+        std::vector<std::string> m_fens;
+        OpeningBook m_book;
+        int m_bookPlies;
+        uint32_t m_seed;
+
+    public:
+        bool load(const MatchOptions& options) {
+            m_bookPlies = options.bookPlies;
+            m_seed = options.seed;
+            if (!options.openings.empty()) {
+                for (const std::string& line : readLines(options.openings)) {
+                    Epd epd;
+                    if (parseEpd(line, epd)) {
+                        m_fens.push_back(epd.fen);
+                    }
+                }
+                std::shuffle(m_fens.begin(), m_fens.end(), std::mt19937(m_seed));
+                return !m_fens.empty();
+            }
+            return options.book.empty() || m_book.open(options.book);
+        }
+
+        Position get(int k) const {
+            Position position;
+            if (!m_fens.empty()) {
+                position.setFromFen(m_fens[k % m_fens.size()]);
+                return position;
+            }
+            position.setStartPosition();
+            std::mt19937 random(m_seed * 1000003u + uint32_t(k));
+            for (int ply = 0; m_book.isOpen() && ply < m_bookPlies; ++ply) {
+                Move move = m_book.probe(position, uint32_t(random()));
+                if (move == Move::none()) {
+                    break;
+                }
+                UndoRecord undo;
+                position.makeMove(move, undo);
+            }
+            return position;
+        }
+    };
+
+    const char* resultText(int result) {
+        return result > 0 ? "1-0" : result < 0 ? "0-1" : "1/2-1/2";
+    }
+
+    int runMatch(const MatchOptions& options) {
+        Openings openings;
+        if (!openings.load(options)) {
+            std::cerr << "Cannot read openings" << std::endl;
+            return 1;
+        }
+        JournalWriter journal;
+        if (!options.journal.empty() && !journal.open(options.journal)) {
+            std::cerr << "Cannot open journal " << options.journal << std::endl;
+            return 1;
+        }
+        int concurrency = options.concurrency > 0 ? options.concurrency : int(std::max(1u, std::thread::hardware_concurrency()));
+        concurrency = std::min(concurrency, options.games);
+
+        std::mutex mutex;  // Guards everything below and the output
+        std::atomic<int> nextGame(0);
+        std::atomic<bool> finished(false);
+        Tally tally;
+        std::string names[2];
+        int verdict = 0;  // 1 H1 accepted, -1 H0 accepted
+        double lower = std::log(options.beta / (1 - options.alpha));
+        double upper = std::log((1 - options.beta) / options.alpha);
+        bool failed = false;
+
+        // Every slot keeps its own pair of engine processes across games
+        auto slot = [&] {
+            UciEngine engines[2];
+            for (;;) {
+                int game = nextGame.fetch_add(1);
+                if (game >= options.games || finished) {
+                    return;
+                }
+                for (int i = 0; i < 2; ++i) {
+                    if (!engines[i].running() && !engines[i].start(options.engines[i])) {
+                        std::lock_guard<std::mutex> lock(mutex);
+                        std::cerr << "Cannot start engine " << i + 1 << std::endl;
+                        failed = finished = true;
+                        return;
+                    }
+                }
+                if (engines[0].name == engines[1].name) {
+                    engines[0].name += " (1)";
+                    engines[1].name += " (2)";
+                }
+                // Engine1 has white in even games, each opening is played from both sides
+                bool swapped = game % 2;
+                UciEngine* players[2] = { &engines[swapped], &engines[!swapped] };
+                GameRecord record = playGame(players, openings.get(game / 2), options);
+                int score = swapped ? -record.result : record.result;
+
+                std::lock_guard<std::mutex> lock(mutex);
+                names[0] = engines[0].name;
+                names[1] = engines[1].name;
+                (score > 0 ? tally.wins : score < 0 ? tally.losses : tally.draws)++;
+                if (journal.isOpen()) {
+                    journal.beginGame(record.start, 0, int64_t(std::time(nullptr)));
+                    for (Move move : record.moves) {
+                        journal.appendMove(move);
+                    }
+                    journal.endGame(record.result > 0 ? JournalGame::WHITE_WINS : record.result < 0 ? JournalGame::BLACK_WINS : JournalGame::DRAW);
+                }
+                std::pair<double, double> elo = eloEstimate(tally);
+                std::printf("Game %d (%s vs %s): %s {%s} %d plies\n", game + 1, players[0]->name.c_str(), players[1]->name.c_str(),
+                            resultText(record.result), record.reason.c_str(), int(record.moves.size()));
+                std::printf("Score of %s vs %s: %d - %d - %d  [%.3f] %d\n", names[0].c_str(), names[1].c_str(),
+                            tally.wins, tally.losses, tally.draws, tally.score(), tally.games());
+                std::printf("Elo difference: %.1f +/- %.1f", elo.first, elo.second);
+                if (options.sprt) {
+                    double llr = logLikelihoodRatio(tally, options.elo0, options.elo1);
+                    std::printf("  LLR: %.2f (%.2f, %.2f) [%.1f, %.1f]", llr, lower, upper, options.elo0, options.elo1);
+                    if (!verdict && (llr >= upper || llr <= lower)) {
+                        verdict = llr >= upper ? 1 : -1;
+                        finished = true;
+                    }
+                }
+                std::printf("\n");
+                std::fflush(stdout);
+            }
+        };
+        std::vector<std::thread> slots;
+        for (int i = 0; i < concurrency; ++i) {
+            slots.emplace_back(slot);
+        }
+        for (std::thread& thread : slots) {
+            thread.join();
+        }
+        journal.close();
+        if (failed) {
+            return 1;
+        }
+        if (options.sprt) {
+            std::printf("SPRT: %s\n", verdict > 0 ? "H1 accepted" : verdict < 0 ? "H0 accepted" : "no decision");
+        }
+        if (!options.sprt || verdict > 0) {
+            return 0;
+        }
+        return verdict < 0 ? 2 : 3;
+    }
+
+    void usage() {
+        std::cerr << "Usage: match epd [--threads n] [--nodes n | --movetime ms | --depth n] [--hash MB] [--nnue file] <suite.epd>\n"
+                     "       match play --engine1 <command> --engine2 <command> [--option1 Name=Value]... [--option2 Name=Value]...\n"
+                     "                  [--games n] [--concurrency n] [--nodes n | --movetime ms | --tc seconds+increment]\n"
+                     "                  [--openings file.epd | --book file.bin [--book-plies n]] [--seed n]\n"
+                     "                  [--sprt elo0 elo1 [alpha beta]] [--resign cp moves] [--draw ply cp moves]\n"
+                     "                  [--max-plies n] [--journal out.cwj]" << std::endl;
+    }
+
+    bool parseOption(const char* text, std::vector<std::pair<std::string, std::string>>& options) {
+        const char* equals = std::strchr(text, '=');
+        if (!equals) {
+            return false;
+        }
+        options.emplace_back(std::string(text, equals), std::string(equals + 1));
+        return true;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    if (argc < 3 || (std::strcmp(argv[1], "epd") != 0 && std::strcmp(argv[1], "play") != 0)) {
+        usage();
+        return 1;
+    }
+    Bitboards::init();
+    std::signal(SIGPIPE, SIG_IGN);  // An engine that died is noticed when its output ends
+
+    if (std::strcmp(argv[1], "epd") == 0) {
+        EpdOptions options;
+        options.limits.moveTime = 1000;
+        std::string path;
+        for (int i = 2; i < argc; ++i) {
+            bool hasValue = i + 1 < argc;
+            if (std::strcmp(argv[i], "--threads") == 0 && hasValue) {
+                options.threads = std::atoi(argv[++i]);
+            } else if (std::strcmp(argv[i], "--nodes") == 0 && hasValue) {
+                options.limits.nodes = std::strtoull(argv[++i], nullptr, 10);
+                options.limits.moveTime = 0;
+            } else if (std::strcmp(argv[i], "--movetime") == 0 && hasValue) {
+                options.limits.moveTime = std::max(1, std::atoi(argv[++i]));
+            } else if (std::strcmp(argv[i], "--depth") == 0 && hasValue) {
+                options.limits.depth = std::min(std::max(1, std::atoi(argv[++i])), MAX_PLY - 1);
+                options.limits.moveTime = 0;
+            } else if (std::strcmp(argv[i], "--hash") == 0 && hasValue) {
+                options.hashMB = std::max(1, std::atoi(argv[++i]));
+            } else if (std::strcmp(argv[i], "--nnue") == 0 && hasValue) {
+                options.nnue = argv[++i];
+            } else if (argv[i][0] != '-' && path.empty()) {
+                path = argv[i];
+            } else {
+                usage();
+                return 1;
+            }
+        }
+        if (path.empty()) {
+            usage();
+            return 1;
+        }
+        return runEpd(options, path);
+    }
+
+    MatchOptions options;
+    for (int i = 2; i < argc; ++i) {
+        std::string arg = argv[i];
+        int values = argc - i - 1;
+        if (arg == "--engine1" && values >= 1) {
+            options.engines[0].command = split(argv[++i]);
+        } else if (arg == "--engine2" && values >= 1) {
+            options.engines[1].command = split(argv[++i]);
+        } else if (arg == "--option1" && values >= 1 && parseOption(argv[i + 1], options.engines[0].options)) {
+            ++i;
+        } else if (arg == "--option2" && values >= 1 && parseOption(argv[i + 1], options.engines[1].options)) {
+            ++i;
+        } else if (arg == "--games" && values >= 1) {
+            options.games = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--concurrency" && values >= 1) {
+            options.concurrency = std::atoi(argv[++i]);
+        } else if (arg == "--nodes" && values >= 1) {
+            options.nodes = std::strtoull(argv[++i], nullptr, 10);
+        } else if (arg == "--movetime" && values >= 1) {
+            options.moveTime = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--tc" && values >= 1) {
+            double base = 0, increment = 0;
+            std::sscanf(argv[++i], "%lf+%lf", &base, &increment);
+            options.baseMs = int(base * 1000);
+            options.incrementMs = int(increment * 1000);
+        } else if (arg == "--openings" && values >= 1) {
+            options.openings = argv[++i];
+        } else if (arg == "--book" && values >= 1) {
+            options.book = argv[++i];
+        } else if (arg == "--book-plies" && values >= 1) {
+            options.bookPlies = std::atoi(argv[++i]);
+        } else if (arg == "--seed" && values >= 1) {
+            options.seed = uint32_t(std::strtoul(argv[++i], nullptr, 10));
+        } else if (arg == "--sprt" && values >= 2) {
+            options.sprt = true;
+            options.elo0 = std::atof(argv[++i]);
+            options.elo1 = std::atof(argv[++i]);
+            if (values >= 4 && argv[i + 1][0] != '-') {
+                options.alpha = std::atof(argv[++i]);
+                options.beta = std::atof(argv[++i]);
+            }
+        } else if (arg == "--resign" && values >= 2) {
+            options.resignCp = std::atoi(argv[++i]);
+            options.resignMoves = std::atoi(argv[++i]);
+        } else if (arg == "--draw" && values >= 3) {
+            options.drawPly = std::atoi(argv[++i]);
+            options.drawCp = std::atoi(argv[++i]);
+            options.drawMoves = std::atoi(argv[++i]);
+        } else if (arg == "--max-plies" && values >= 1) {
+            options.maxPlies = std::max(1, std::atoi(argv[++i]));
+        } else if (arg == "--journal" && values >= 1) {
+            options.journal = argv[++i];
+        } else {
+            usage();
+            return 1;
+        }
+    }
+    if (options.engines[0].command.empty() || options.engines[1].command.empty()
+        || (!options.nodes && !options.moveTime && !options.baseMs)
+        || !(options.alpha > 0 && options.alpha < 1 && options.beta > 0 && options.beta < 1)) {
+        usage();
+        return 1;
+    }
+    return runMatch(options);
+}
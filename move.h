@@ -0,0 +1,82 @@
+// Move representation shared by the position, the generator and the UI.
+
+#ifndef MOVE_H
+#define MOVE_H
+
+#include "bitboard.h"
+
+// A move packed into 16 bits:
+//   bits 0-5   origin square
+//   bits 6-11  destination square
+//   bits 12-13 promotion piece - KNIGHT
+//   bits 14-15 special move flag
+enum MoveFlag {
+    NORMAL = 0,
+    PROMOTION = 1 << 14,
+    EN_PASSANT = 2 << 14,
+    CASTLING = 3 << 14
+};
+
+class Move {
+private:
+    uint16_t m_data;
+
+public:
+    Move() = default;
+    Move(int from, int to, MoveFlag flag = NORMAL, PieceType promotion = KNIGHT)
+        : m_data(uint16_t(from | (to << 6) | ((promotion - KNIGHT) << 12) | flag)) {}
+
+    static Move none() { return fromRaw(0); }
+    static Move fromRaw(uint16_t data) {
+        Move m;
+        m.m_data = data;
+        return m;
+    }
+
+    int from() const { return m_data & 0x3F; }
+    int to() const { return (m_data >> 6) & 0x3F; }
+    MoveFlag flag() const { return MoveFlag(m_data & (3 << 14)); }
+    PieceType promotion() const { return PieceType(((m_data >> 12) & 3) + KNIGHT); }
+    bool isPromotion() const { return flag() == PROMOTION; }
+    uint16_t raw() const { return m_data; }
+
+    bool operator==(const Move& other) const { return m_data == other.m_data; }
+    bool operator!=(const Move& other) const { return m_data != other.m_data; }
+};
+
+// Fixed-capacity move list meant to live on the stack. No legal chess
+// position has more than 218 moves, so 256 never overflows.
+class MoveList {
+public:
+    static const int Capacity = 256;
+
+private:
+    Move m_moves[Capacity];
+    int m_size;
+
+public:
+    MoveList() : m_size(0) {}
+
+    void add(Move move) { m_moves[m_size++] = move; }
+    void clear() { m_size = 0; }
+    int size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+
+    Move& operator[](int i) { return m_moves[i]; }
+    Move operator[](int i) const { return m_moves[i]; }
+    Move* begin() { return m_moves; }
+    Move* end() { return m_moves + m_size; }
+    const Move* begin() const { return m_moves; }
+    const Move* end() const { return m_moves + m_size; }
+
+    bool contains(Move move) const {
+        for (Move m : *this) {
+            if (m == move) {
+                return true;
+            }
+        }
+        return false;
+    }
+};
+
+#endif
@@ -0,0 +1,187 @@
+#include "movegen.h"
+#include "profiler.h"
+
+namespace {
+    // What every piece generator of one position shares.
+    struct Context {
+        int ksq;
+        Bitboard occupied;
+        Bitboard enemy;
+        Bitboard pinned;
+        Bitboard targets;  // Squares the kind of move may go to, within the check mask
+    };
+
+    void addMoves(int from, Bitboard targets, MoveList& moves) {
+        while (targets) {
+            moves.add(Move(from, popLsb(targets)));
+        }
+    }
+
+    template <PieceType Pt>
+    Bitboard attacks(int sq, Bitboard occupied) {
+        if constexpr (Pt == KNIGHT) {
+            return knightAttacks(sq);
+        } else if constexpr (Pt == BISHOP) {
+            return bishopAttacks(sq, occupied);
+        } else if constexpr (Pt == ROOK) {
+            return rookAttacks(sq, occupied);
+        } else {
+            return queenAttacks(sq, occupied);
+        }
+    }
+
+    template <Color Us, PieceType Pt>
+    void generatePiece(const Position& position, const Context& c, MoveList& moves) {
+        // A pinned knight can never move along the pin
+        Bitboard pieces = position.pieces(Us, Pt) & ~(Pt == KNIGHT ? c.pinned : 0);
+        while (pieces) {
+            int from = popLsb(pieces);
+            Bitboard targets = attacks<Pt>(from, c.occupied) & c.targets;
+            if (c.pinned & squareBB(from)) {
+                targets &= lineBB(c.ksq, from);
+            }
+            addMoves(from, targets, moves);
+        }
+    }
+
+    template <Color Us, GenType Type>
+    void generatePawns(const Position& position, const Context& c, Bitboard checkMask, MoveList& moves) {
+        constexpr Color Them = Us == WHITE ? BLACK : WHITE;
+        constexpr int Up = Us == WHITE ? 8 : -8;
+        constexpr Bitboard StartRank = Us == WHITE ? RANK_2_BB : RANK_8_BB >> 8;
+        constexpr Bitboard LastRank = Us == WHITE ? RANK_8_BB : RANK_1_BB;
+
+        Bitboard pawns = position.pieces(Us, PAWN);
+        while (pawns) {
+            int from = popLsb(pawns);
+            Bitboard targets = 0;
+            if (Type != QUIETS) {
+                targets |= pawnAttacks(Us, from) & c.enemy;
+            }
+            if (!(c.occupied & squareBB(from + Up))) {
+                // Pushes are quiet unless they promote
+                Bitboard push = squareBB(from + Up);
+                if ((StartRank & squareBB(from)) && !(c.occupied & squareBB(from + 2 * Up))) {
+                    push |= squareBB(from + 2 * Up);
+                }
+                targets |= Type == CAPTURES ? push & LastRank : Type == QUIETS ? push & ~LastRank : push;
+            }
+            targets &= checkMask;
+            if (c.pinned & squareBB(from)) {
+                targets &= lineBB(c.ksq, from);
+            }
+            while (targets) {
+                int to = popLsb(targets);
+                if (squareBB(to) & LastRank) {
+                    for (int pt = QUEEN; pt >= KNIGHT; --pt) {
+                        moves.add(Move(from, to, PROMOTION, PieceType(pt)));
+                    }
+                } else {
+                    moves.add(Move(from, to));
+                }
+            }
+
+            // En passant removes two pieces from one rank, which no pin mask
+            // covers, so it is checked against the resulting occupancy instead
+            int ep = position.epSquare();
+            if (Type != QUIETS && ep != NO_SQUARE && (pawnAttacks(Us, from) & squareBB(ep))) {
+                int victim = ep - Up;
+                Bitboard after = (c.occupied ^ squareBB(from) ^ squareBB(victim)) | squareBB(ep);
+                if (!(position.attackersTo(c.ksq, after) & position.pieces(Them) & ~squareBB(victim))) {
+                    moves.add(Move(from, ep, EN_PASSANT));
+                }
+            }
+        }
+    }
+
+    // The king may not castle out of, through or into check.
+    template <Color Us>
+    void generateCastling(const Position& position, const Context& c, MoveList& moves) {
+        constexpr Color Them = Us == WHITE ? BLACK : WHITE;
+        constexpr int KingSide = Us == WHITE ? WHITE_OO : BLACK_OO;
+        constexpr int QueenSide = Us == WHITE ? WHITE_OOO : BLACK_OOO;
+        int ksq = c.ksq;
+
+        if ((position.castlingRights() & KingSide) && !(c.occupied & betweenBB(ksq, ksq + 3)) &&
+            !position.isSquareAttacked(ksq + 1, Them) && !position.isSquareAttacked(ksq + 2, Them)) {
+            moves.add(Move(ksq, ksq + 2, CASTLING));
+        }
+        if ((position.castlingRights() & QueenSide) && !(c.occupied & betweenBB(ksq, ksq - 4)) &&
+            !position.isSquareAttacked(ksq - 1, Them) && !position.isSquareAttacked(ksq - 2, Them)) {
+            moves.add(Move(ksq, ksq - 2, CASTLING));
+        }
+    }
+
+    template <Color Us, GenType Type>
+    void generateAll(const Position& position, MoveList& moves) {
+        constexpr Color Them = Us == WHITE ? BLACK : WHITE;
+        Context c;
+        c.ksq = position.kingSquare(Us);
+        c.occupied = position.occupied();
+        c.enemy = position.pieces(Them);
+        Bitboard own = position.pieces(Us);
+        Bitboard kinds = Type == CAPTURES ? c.enemy : Type == QUIETS ? ~c.occupied : ~own;
+
+        // King steps, with the king lifted off the board so it cannot hide
+        // behind itself from a slider that is already giving check
+        Bitboard targets = kingAttacks(c.ksq) & kinds;
+        while (targets) {
+            int to = popLsb(targets);
+            if (!(position.attackersTo(to, c.occupied ^ squareBB(c.ksq)) & c.enemy)) {
+                moves.add(Move(c.ksq, to));
+            }
+        }
+        Bitboard checkers = position.checkers();
+        if (checkers & (checkers - 1)) {
+            return;  // Double check, only the king can move
+        }
+
+        // Other pieces must capture the checker or block its ray
+        Bitboard checkMask = ~Bitboard(0);
+        if (checkers) {
+            checkMask = betweenBB(c.ksq, lsb(checkers)) | checkers;
+        } else if (Type != CAPTURES) {
+            generateCastling<Us>(position, c, moves);
+        }
+        c.pinned = position.pinnedPieces(Us);
+        c.targets = kinds & checkMask;
+
+        generatePiece<Us, KNIGHT>(position, c, moves);
+        generatePiece<Us, BISHOP>(position, c, moves);
+        generatePiece<Us, ROOK>(position, c, moves);
+        generatePiece<Us, QUEEN>(position, c, moves);
+        generatePawns<Us, Type>(position, c, checkMask, moves);
+    }
+}
+
+std::string moveToString(Move move) {
+    std::string s;
+    s += char('a' + squareFile(move.from()));
+    s += char('1' + squareRank(move.from()));
+    s += char('a' + squareFile(move.to()));
+    s += char('1' + squareRank(move.to()));
+    if (move.isPromotion()) {
+        s += "pnbrqk"[move.promotion()];
+    }
+    return s;
+}
+
+template <GenType Type>
+void generate(const Position& position, MoveList& moves) {
+    PROFILE_COUNT(MOVE_GENERATION);
+    if (position.sideToMove() == WHITE) {
+        generateAll<WHITE, Type>(position, moves);
+    } else {
+        generateAll<BLACK, Type>(position, moves);
+    }
+}
+
+template void generate<CAPTURES>(const Position& position, MoveList& moves);
+template void generate<QUIETS>(const Position& position, MoveList& moves);
+template void generate<LEGAL>(const Position& position, MoveList& moves);
+
+bool hasLegalMove(const Position& position) {
+    MoveList moves;
+    generate<LEGAL>(position, moves);
+    return !moves.empty();
+}
@@ -0,0 +1,34 @@
+// Legal move generation. Checkers and pinned pieces are computed once per
+// position, so every emitted move is legal without trying it on the board.
+//
+// The generator is a template over the side to move, the piece type and
+// the kind of moves wanted, so the colour tests, pawn directions and piece
+// attack lookups are resolved at compile time and the per-piece loops are
+// inlined into one function per side and kind.
+
+#ifndef MOVEGEN_H
+#define MOVEGEN_H
+
+#include "position.h"
+#include <string>
+
+enum GenType {
+    CAPTURES,  // Captures, en passant and every promotion
+    QUIETS,    // All other moves, castling included
+    LEGAL      // Both
+};
+
+// Coordinate notation, e.g. "e2e4" or "e7e8q".
+std::string moveToString(Move move);
+
+// Legal moves of the given kind for the side to move, promotions expanded
+// to all four pieces. CAPTURES and QUIETS split LEGAL without overlap, in
+// check too.
+template <GenType Type>
+void generate(const Position& position, MoveList& moves);
+
+inline void generateLegalMoves(const Position& position, MoveList& moves) { generate<LEGAL>(position, moves); }
+
+bool hasLegalMove(const Position& position);
+
+#endif
@@ -0,0 +1,247 @@
+#include "nnue.h"
+#include "mapped_file.h"
+#include <cstring>
+#include <immintrin.h>
+#include <memory>
+
+namespace {
+    const char NetworkMagic[8] = { 'C', 'W', 'O', 'N', 'N', 'U', 'E', '1' };
+    const size_t HeaderSize = 64;
+
+    std::unique_ptr<MappedFile> network;
+    int hidden = 0;
+    const int16_t* featureWeights = nullptr;
+    const int16_t* biases = nullptr;
+    const int16_t* outputWeights = nullptr;
+    int32_t outputBias = 0;
+
+    // Input of a piece on a square as seen by perspective
+    int feature(int pieceSquare, Color perspective) {
+        if (perspective == WHITE) {
+            return pieceSquare;
+        }
+        int piece = pieceSquare / 64;
+        return makePiece(~pieceColor(piece), pieceType(piece)) * 64 + (pieceSquare % 64 ^ 56);
+    }
+
+    const int16_t* weightRow(int pieceSquare, Color perspective) {
+        return featureWeights + feature(pieceSquare, perspective) * hidden;
+    }
+
+    // out = in + the add rows - the sub rows, n values wide
+    typedef void (*UpdateKernel)(int16_t* out, const int16_t* in, const int16_t* const add[], int addCount,
+                                 const int16_t* const sub[], int subCount, int n);
+    // Clipped us and them times the two halves of weights
+    typedef int32_t (*DotKernel)(const int16_t* us, const int16_t* them, const int16_t* weights, int n);
+
+    void updateScalar(int16_t* out, const int16_t* in, const int16_t* const add[], int addCount,
+                      const int16_t* const sub[], int subCount, int n) {
+        for (int i = 0; i < n; ++i) {
+            int16_t value = in[i];
+            for (int j = 0; j < addCount; ++j) {
+                value = int16_t(value + add[j][i]);
+            }
+            for (int j = 0; j < subCount; ++j) {
+                value = int16_t(value - sub[j][i]);
+            }
+            out[i] = value;
+        }
+    }
+
+    int32_t dotScalar(const int16_t* us, const int16_t* them, const int16_t* weights, int n) {
+        // Wraps like the vector kernels instead of overflowing
+        uint32_t sum = 0;
+        for (int i = 0; i < n; ++i) {
+            int u = us[i] < 0 ? 0 : us[i] > Nnue::QA ? Nnue::QA : us[i];
+            int t = them[i] < 0 ? 0 : them[i] > Nnue::QA ? Nnue::QA : them[i];
+            sum += uint32_t(u * weights[i]) + uint32_t(t * weights[n + i]);
+        }
+        return int32_t(sum);
+    }
+
+    __attribute__((target("sse4.1")))
+    void updateSse41(int16_t* out, const int16_t* in, const int16_t* const add[], int addCount,
+                     const int16_t* const sub[], int subCount, int n) {
+        for (int i = 0; i < n; i += 8) {
+            __m128i value = _mm_loadu_si128(reinterpret_cast<const __m128i*>(in + i));
+            for (int j = 0; j < addCount; ++j) {
+                value = _mm_add_epi16(value, _mm_loadu_si128(reinterpret_cast<const __m128i*>(add[j] + i)));
+            }
+            for (int j = 0; j < subCount; ++j) {
+                value = _mm_sub_epi16(value, _mm_loadu_si128(reinterpret_cast<const __m128i*>(sub[j] + i)));
+            }
+            _mm_storeu_si128(reinterpret_cast<__m128i*>(out + i), value);
+        }
+    }
+
+    __attribute__((target("sse4.1")))
+    int32_t dotSse41(const int16_t* us, const int16_t* them, const int16_t* weights, int n) {
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i qa = _mm_set1_epi16(Nnue::QA);
+        __m128i sum = zero;
+        for (int i = 0; i < n; i += 8) {
+            __m128i u = _mm_min_epi16(_mm_max_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(us + i)), zero), qa);
+            __m128i t = _mm_min_epi16(_mm_max_epi16(_mm_loadu_si128(reinterpret_cast<const __m128i*>(them + i)), zero), qa);
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(u, _mm_loadu_si128(reinterpret_cast<const __m128i*>(weights + i))));
+            sum = _mm_add_epi32(sum, _mm_madd_epi16(t, _mm_loadu_si128(reinterpret_cast<const __m128i*>(weights + n + i))));
+        }
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(1, 0, 3, 2)));
+        sum = _mm_add_epi32(sum, _mm_shuffle_epi32(sum, _MM_SHUFFLE(2, 3, 0, 1)));
+        return _mm_cvtsi128_si32(sum);
+    }
+
+    __attribute__((target("avx2")))
+    void updateAvx2(int16_t* out, const int16_t* in, const int16_t* const add[], int addCount,
+                    const int16_t* const sub[], int subCount, int n) {
+        for (int i = 0; i < n; i += 16) {
+            __m256i value = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(in + i));
+            for (int j = 0; j < addCount; ++j) {
+                value = _mm256_add_epi16(value, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(add[j] + i)));
+            }
+            for (int j = 0; j < subCount; ++j) {
+                value = _mm256_sub_epi16(value, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(sub[j] + i)));
+            }
+            _mm256_storeu_si256(reinterpret_cast<__m256i*>(out + i), value);
+        }
+    }
+
+    __attribute__((target("avx2")))
+    int32_t dotAvx2(const int16_t* us, const int16_t* them, const int16_t* weights, int n) {
+        const __m256i zero = _mm256_setzero_si256();
+        const __m256i qa = _mm256_set1_epi16(Nnue::QA);
+        __m256i sum = zero;
+        for (int i = 0; i < n; i += 16) {
+            __m256i u = _mm256_min_epi16(_mm256_max_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(us + i)), zero), qa);
+            __m256i t = _mm256_min_epi16(_mm256_max_epi16(_mm256_loadu_si256(reinterpret_cast<const __m256i*>(them + i)), zero), qa);
+            sum = _mm256_add_epi32(sum, _mm256_madd_epi16(u, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(weights + i))));
+            sum = _mm256_add_epi32(sum, _mm256_madd_epi16(t, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(weights + n + i))));
+        }
+        __m128i half = _mm_add_epi32(_mm256_castsi256_si128(sum), _mm256_extracti128_si256(sum, 1));
+        half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(1, 0, 3, 2)));
+        half = _mm_add_epi32(half, _mm_shuffle_epi32(half, _MM_SHUFFLE(2, 3, 0, 1)));
+        return _mm_cvtsi128_si32(half);
+    }
+
+    Nnue::Simd simdLimit = Nnue::AVX2;
+    Nnue::Simd activeSimd = Nnue::SCALAR;
+    UpdateKernel updateKernel = updateScalar;
+    DotKernel dotKernel = dotScalar;
+}
+
+namespace Nnue {
+    bool load(const std::string& path) {
+        std::unique_ptr<MappedFile> file(new MappedFile);
+        if (!file->open(path) || file->size() < HeaderSize ||
+            std::memcmp(file->data(), NetworkMagic, sizeof(NetworkMagic)) != 0) {
+            return false;
+        }
+        uint32_t size;
+        std::memcpy(&size, file->data() + sizeof(NetworkMagic), sizeof(size));
+        if (size == 0 || size > uint32_t(MaxHidden) || size % 32 != 0 ||
+            file->size() != HeaderSize + sizeof(int16_t) * (Inputs + 3) * size + sizeof(int32_t)) {
+            return false;
+        }
+
+        // Every block starts on a 64 byte boundary of the page-aligned mapping
+        network = std::move(file);
+        hidden = int(size);
+        featureWeights = reinterpret_cast<const int16_t*>(network->data() + HeaderSize);
+        biases = featureWeights + Inputs * hidden;
+        outputWeights = biases + hidden;
+        std::memcpy(&outputBias, outputWeights + 2 * hidden, sizeof(outputBias));
+        setSimd(simdLimit);
+        return true;
+    }
+
+    void release() {
+        network.reset();
+        hidden = 0;
+        featureWeights = biases = outputWeights = nullptr;
+        outputBias = 0;
+    }
+
+    bool isLoaded() { return hidden != 0; }
+
+    int hiddenSize() { return hidden; }
+
+    void setSimd(Simd limit) {
+        simdLimit = limit;
+        __builtin_cpu_init();
+        if (limit >= AVX2 && __builtin_cpu_supports("avx2")) {
+            activeSimd = AVX2;
+            updateKernel = updateAvx2;
+            dotKernel = dotAvx2;
+        } else if (limit >= SSE41 && __builtin_cpu_supports("sse4.1")) {
+            activeSimd = SSE41;
+            updateKernel = updateSse41;
+            dotKernel = dotSse41;
+        } else {
+            activeSimd = SCALAR;
+            updateKernel = updateScalar;
+            dotKernel = dotScalar;
+        }
+    }
+
+    Simd simd() { return activeSimd; }
+
+    const char* simdName() {
+        return activeSimd == AVX2 ? "avx2" : activeSimd == SSE41 ? "sse4.1" : "scalar";
+    }
+
+    void refresh(const Position& position, Accumulator& accumulator) {
+        const int16_t* rows[32];
+        for (Color perspective : { WHITE, BLACK }) {
+            int count = 0;
+            for (Bitboard b = position.occupied(); b;) {
+                int sq = popLsb(b);
+                rows[count++] = weightRow(position.pieceOn(sq) * 64 + sq, perspective);
+            }
+            updateKernel(accumulator.values[perspective], biases, rows, count, nullptr, 0, hidden);
+        }
+    }
+
+    Delta delta(const Position& position, Move move) {
+        Delta delta;
+        delta.removedCount = delta.addedCount = 0;
+        int from = move.from(), to = move.to();
+        int piece = position.pieceOn(from);
+        Color us = pieceColor(piece);
+
+        delta.removed[delta.removedCount++] = piece * 64 + from;
+        if (move.flag() == EN_PASSANT) {
+            int sq = to + (us == WHITE ? -8 : 8);
+            delta.removed[delta.removedCount++] = makePiece(~us, PAWN) * 64 + sq;
+        } else if (position.pieceOn(to) != NO_PIECE) {
+            delta.removed[delta.removedCount++] = position.pieceOn(to) * 64 + to;
+        }
+        delta.added[delta.addedCount++] = (move.isPromotion() ? makePiece(us, move.promotion()) : piece) * 64 + to;
+        if (move.flag() == CASTLING) {
+            int rookFrom = (to > from) ? to + 1 : to - 2;
+            int rookTo = (to > from) ? to - 1 : to + 1;
+            delta.removed[delta.removedCount++] = makePiece(us, ROOK) * 64 + rookFrom;
+            delta.added[delta.addedCount++] = makePiece(us, ROOK) * 64 + rookTo;
+        }
+        return delta;
+    }
+
+    void update(const Accumulator& from, Accumulator& to, const Delta& delta) {
+        const int16_t* added[2];
+        const int16_t* removed[2];
+        for (Color perspective : { WHITE, BLACK }) {
+            for (int i = 0; i < delta.addedCount; ++i) {
+                added[i] = weightRow(delta.added[i], perspective);
+            }
+            for (int i = 0; i < delta.removedCount; ++i) {
+                removed[i] = weightRow(delta.removed[i], perspective);
+            }
+            updateKernel(to.values[perspective], from.values[perspective], added, delta.addedCount,
+                         removed, delta.removedCount, hidden);
+        }
+    }
+
+    int evaluate(const Position& position, const Accumulator& accumulator) {
+        Color us = position.sideToMove();
+        int64_t sum = int64_t(dotKernel(accumulator.values[us], accumulator.values[~us], outputWeights, hidden)) + outputBias;
+        return int(sum * Scale / (QA * QB));
+    }
+}
@@ -0,0 +1,79 @@
+// Optional neural network evaluation (NNUE), used instead of evaluate()
+// once a network is loaded.
+//
+// One hidden layer over 768 inputs, one per color, piece type and square,
+// seen from each side: for black the colors are swapped and the board is
+// flipped. The hidden layer is kept per position in an Accumulator, which a
+// move changes by adding and subtracting a few weight rows instead of
+// summing the whole board again. Both halves, the side to move's first, go
+// through a clipped ReLU into a single output.
+//
+// The network file is memory-mapped and the weights are used in place. The
+// add, subtract and dot product kernels use AVX2 or SSE4.1 when the CPU
+// has them and plain loops otherwise, picked when the network is loaded.
+//
+// File layout, all fields little-endian:
+//   char magic[8] "CWONNUE1", uint32_t hidden size (a multiple of 32 up to
+//   MaxHidden), zeros up to byte 64, then int16_t feature weights
+//   [768][hidden], int16_t hidden biases [hidden], int16_t output weights
+//   [2 * hidden], int32_t output bias.
+// Hidden values are scaled by QA, output weights by QB and the output
+// comes out as Scale centipawns per QA * QB.
+
+#ifndef NNUE_H
+#define NNUE_H
+
+#include "position.h"
+#include <cstdint>
+#include <string>
+
+namespace Nnue {
+    const int Inputs = 768;
+    const int MaxHidden = 1024;
+    const int QA = 255;
+    const int QB = 64;
+    const int Scale = 400;
+
+    struct alignas(64) Accumulator {
+        int16_t values[2][MaxHidden];  // Hidden layer seen by white and by black
+    };
+
+    // Pieces a move takes off and puts on squares, as piece * 64 + square.
+    // Castling moves two pieces, a capture removes two and adds one.
+    struct Delta {
+        int removed[2];
+        int added[2];
+        int removedCount;
+        int addedCount;
+    };
+
+    enum Simd {
+        SCALAR,
+        SSE41,
+        AVX2
+    };
+
+    // Maps a network file, false if it cannot be read or is malformed. Not
+    // safe during a search.
+    bool load(const std::string& path);
+    void release();
+    bool isLoaded();
+    int hiddenSize();
+
+    // Kernels in use, the best the CPU supports up to limit.
+    void setSimd(Simd limit);
+    Simd simd();
+    const char* simdName();
+
+    // Sums the whole board into accumulator.
+    void refresh(const Position& position, Accumulator& accumulator);
+    // Changes of move, a legal move of position before it is played.
+    Delta delta(const Position& position, Move move);
+    // to = from with the changes of a move applied.
+    void update(const Accumulator& from, Accumulator& to, const Delta& delta);
+    // Centipawns from the side to move's point of view, accumulator must
+    // match position.
+    int evaluate(const Position& position, const Accumulator& accumulator);
+}
+
+#endif
@@ -0,0 +1,152 @@
+#include "notation.h"
+#include "movegen.h"
+
+namespace {
+    const char PieceLetters[] = "PNBRQK";
+
+    int pieceFromLetter(char c) {
+        for (int pt = KNIGHT; pt <= KING; ++pt) {
+            if (c == PieceLetters[pt]) {
+                return pt;
+            }
+        }
+        return -1;
+    }
+
+    int promotionFromLetter(char c) {
+        switch (c) {
+            case 'N': case 'n': return KNIGHT;
+            case 'B': case 'b': return BISHOP;
+            case 'R': case 'r': return ROOK;
+            case 'Q': case 'q': return QUEEN;
+        }
+        return -1;
+    }
+
+    bool isFile(char c) { return c >= 'a' && c <= 'h'; }
+    bool isRank(char c) { return c >= '1' && c <= '8'; }
+}
+
+Move parseSan(const Position& position, std::string_view san) {
+    while (!san.empty() && (san.back() == '+' || san.back() == '#' || san.back() == '!' || san.back() == '?')) {
+        san.remove_suffix(1);
+    }
+    if (san.size() < 2) {
+        return Move::none();
+    }
+
+    MoveList moves;
+    generateLegalMoves(position, moves);
+
+    // Castling, also accepted with zeros
+    if (san == "O-O" || san == "0-0" || san == "O-O-O" || san == "0-0-0") {
+        bool kingSide = san.size() == 3;
+        for (Move move : moves) {
+            if (move.flag() == CASTLING && (move.to() > move.from()) == kingSide) {
+                return move;
+            }
+        }
+        return Move::none();
+    }
+
+    int piece = pieceFromLetter(san[0]);
+    size_t begin = piece < 0 ? 0 : 1;
+    if (piece < 0) {
+        piece = PAWN;
+    }
+    size_t end = san.size();
+    int promotion = -1;
+    if (piece == PAWN && end > 2 && promotionFromLetter(san[end - 1]) >= 0 && !isRank(san[end - 1])) {
+        promotion = promotionFromLetter(san[end - 1]);
+        --end;
+        if (san[end - 1] == '=') {
+            --end;
+        }
+    }
+    if (end < begin + 2 || !isFile(san[end - 2]) || !isRank(san[end - 1])) {
+        return Move::none();
+    }
+    int to = (san[end - 1] - '1') * 8 + (san[end - 2] - 'a');
+
+    // Whatever sits between the piece and the destination narrows the origin
+    int fromFile = -1, fromRank = -1;
+    for (size_t i = begin; i < end - 2; ++i) {
+        if (isFile(san[i])) {
+            fromFile = san[i] - 'a';
+        } else if (isRank(san[i])) {
+            fromRank = san[i] - '1';
+        } else if (san[i] != 'x' && san[i] != '-' && san[i] != ':') {
+            return Move::none();
+        }
+    }
+
+    Move found = Move::none();
+    int matches = 0;
+    for (Move move : moves) {
+        if (move.to() != to || move.flag() == CASTLING || pieceType(position.pieceOn(move.from())) != piece) {
+            continue;
+        }
+        if ((fromFile >= 0 && squareFile(move.from()) != fromFile) || (fromRank >= 0 && squareRank(move.from()) != fromRank)) {
+            continue;
+        }
+        if (move.isPromotion() ? move.promotion() != promotion : promotion >= 0) {
+            continue;
+        }
+        found = move;
+        ++matches;
+    }
+    return matches == 1 ? found : Move::none();
+}
+
+std::string moveToSan(const Position& position, Move move) {
+    std::string san;
+    int from = move.from(), to = move.to();
+    if (move.flag() == CASTLING) {
+        san = to > from ? "O-O" : "O-O-O";
+    } else {
+        PieceType piece = pieceType(position.pieceOn(from));
+        bool capture = position.pieceOn(to) != NO_PIECE || move.flag() == EN_PASSANT;
+        if (piece == PAWN) {
+            if (capture) {
+                san += char('a' + squareFile(from));
+            }
+        } else {
+            san += PieceLetters[piece];
+            // Name the file, else the rank, else both, of the other pieces
+            // of the same kind that reach the same square
+            MoveList moves;
+            generateLegalMoves(position, moves);
+            bool ambiguous = false, sameFile = false, sameRank = false;
+            for (Move other : moves) {
+                if (other != move && other.to() == to && pieceType(position.pieceOn(other.from())) == piece) {
+                    ambiguous = true;
+                    sameFile |= squareFile(other.from()) == squareFile(from);
+                    sameRank |= squareRank(other.from()) == squareRank(from);
+                }
+            }
+            if (ambiguous && (!sameFile || sameRank)) {
+                san += char('a' + squareFile(from));
+            }
+            if (ambiguous && sameFile) {
+                san += char('1' + squareRank(from));
+            }
+        }
+        if (capture) {
+            san += 'x';
+        }
+        san += char('a' + squareFile(to));
+        san += char('1' + squareRank(to));
+        if (move.isPromotion()) {
+            san += '=';
+            san += PieceLetters[move.promotion()];
+        }
+    }
+
+    Position next = position;
+    UndoRecord undo;
+    next.makeMove(move, undo);
+    if (next.checkers()) {
+        san += hasLegalMove(next) ? '+' : '#';
+    }
+    return san;
+}
@@ -0,0 +1,18 @@
+// Standard algebraic notation (SAN), e.g. "Nbd7", "exd6", "O-O", "e8=Q+".
+
+#ifndef NOTATION_H
+#define NOTATION_H
+
+#include "position.h"
+#include <string>
+#include <string_view>
+
+// Legal move of position written as san, Move::none() if it is malformed,
+// illegal or ambiguous. Check, mate and annotation suffixes are ignored.
+// Works on the stack only, so replaying a game never allocates.
+Move parseSan(const Position& position, std::string_view san);
+
+// SAN of a legal move, with the +/# suffix.
+std::string moveToSan(const Position& position, Move move);
+
+#endif
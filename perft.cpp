@@ -0,0 +1,230 @@
+// Headless perft driver: counts the leaf nodes of the legal move tree to
+// check the move generator against known numbers and to measure its speed.
+//
+//   perft <fen|startpos> <depth> [threads]   divide output for one position
+//   perft suite [threads]                    runs the reference positions
+//   perft variant <8x8|10x8|10x10> <fen|start> <depth>
+//                                            one thread, the geometry templates of variant.h
+//
+// Pass --no-pext to force the magic-multiply slider lookups.
+
+#include "movegen.h"
+#include "variant.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <vector>
+
+namespace {
+    struct SuiteEntry {
+        const char* fen;
+        int depth;
+        uint64_t nodes;
+    };
+
+    // Reference positions from the Chess Programming Wiki perft results page.
+    const SuiteEntry Suite[] = {
+        { "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", 5, 4865609 },
+        { "r3k2r/p1ppqpb1/bn2pnp1/3PN3/1p2P3/2N2Q1p/PPPBBPPP/R3K2R w KQkq - 0 1", 4, 4085603 },
+        { "8/2p5/3p4/KP5r/1R3p1k/8/4P1P1/8 w - - 0 1", 5, 674624 },
+        { "r3k2r/Pppp1ppp/1b3nbN/nP6/BBP1P3/q4N2/Pp1P2PP/R2Q1RK1 w kq - 0 1", 4, 422333 },
+        { "r2q1rk1/pP1p2pp/Q4n2/bbp1p3/Np6/1B3NBn/pPPP1PPP/R3K2R b KQ - 0 1", 4, 422333 },
+        { "rnbq1k1r/pp1Pbppp/2p5/8/2B5/8/PPP1NnPP/RNBQK2R w KQ - 1 8", 4, 2103487 },
+        { "r4rk1/1pp1qppp/p1np1n2/2b1p1B1/2B1P1b1/P1NP1N2/1PP1QPPP/R4RK1 w - - 0 10", 4, 3894594 },
+        // Castling and en passant rights the board cannot back are dropped
+        { "4k3/8/8/8/8/8/8/4K3 w KQ - 0 1", 1, 5 },
+        { "4k3/8/8/8/8/8/3P4/4K3 w - e3 0 1", 1, 6 },
+        { "4k3/8/8/3P4/8/8/8/4K3 w - e6 0 1", 1, 6 },
+    };
+
+    struct RejectedEntry {
+        const char* fen;
+        bool strict;
+    };
+
+    // Positions setFromFen has to refuse.
+    const RejectedEntry Rejected[] = {
+        { "k6R/8/8/8/8/8/8/K7 w - - 0 1", false },  // Side not to move in check
+        { "rnbqkbnr/pppppppp/8/8/4Q3/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1", false },  // 17 white pieces
+        { "4k3/8/8/8/8/8/8/4K3 w KQ - 0 1", true },  // Castling without rooks
+        { "4k3/8/8/8/8/8/3P4/4K3 w - e3 0 1", true },
+        { "4k3/8/8/3P4/8/8/8/4K3 w - e6 0 1", true },
+    };
+
+    uint64_t perft(Position& position, int depth, UndoStack& undo) {
+        MoveList moves;
+        generateLegalMoves(position, moves);
+        if (depth <= 1) {
+            return depth == 1 ? moves.size() : 1;
+        }
+        uint64_t nodes = 0;
+        for (Move move : moves) {
+            position.makeMove(move, undo);
+            nodes += perft(position, depth - 1, undo);
+            position.unmakeMove(undo);
+        }
+        return nodes;
+    }
+
+    // Splits the root moves over the worker threads, each thread pulls the
+    // next unclaimed root move until none are left.
+    std::vector<uint64_t> divide(const Position& position, const MoveList& moves, int depth, int threads) {
+        std::vector<uint64_t> counts(moves.size(), 0);
+        std::atomic<int> next(0);
+        auto worker = [&]() {
+            Position child = position;
+            UndoStack undo;
+            for (int i = next++; i < moves.size(); i = next++) {
+                child.makeMove(moves[i], undo);
+                counts[i] = perft(child, depth - 1, undo);
+                child.unmakeMove(undo);
+            }
+        };
+        std::vector<std::thread> pool;
+        for (int i = 1; i < threads; ++i) {
+            pool.emplace_back(worker);
+        }
+        worker();
+        for (auto& t : pool) {
+            t.join();
+        }
+        return counts;
+    }
+
+    double secondsSince(std::chrono::steady_clock::time_point start) {
+        return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    }
+
+    uint64_t runPerft(const Position& position, int depth, int threads, bool printDivide) {
+        MoveList moves;
+        generateLegalMoves(position, moves);
+        auto start = std::chrono::steady_clock::now();
+        uint64_t nodes = 0;
+        if (depth <= 1) {
+            nodes = depth == 1 ? moves.size() : 1;
+        } else {
+            std::vector<uint64_t> counts = divide(position, moves, depth, threads);
+            for (int i = 0; i < moves.size(); ++i) {
+                if (printDivide) {
+                    std::cout << moveToString(moves[i]) << ": " << counts[i] << std::endl;
+                }
+                nodes += counts[i];
+            }
+        }
+        double seconds = secondsSince(start);
+        std::cout << "Nodes: " << nodes << "  Time: " << int(seconds * 1000) << " ms  NPS: "
+                  << uint64_t(seconds > 0 ? nodes / seconds : 0) << std::endl;
+        return nodes;
+    }
+
+    int runSuite(int threads) {
+        int failures = 0;
+        for (const SuiteEntry& entry : Suite) {
+            Position position;
+            position.setFromFen(entry.fen);
+            std::cout << entry.fen << "  depth " << entry.depth << std::endl;
+            uint64_t nodes = runPerft(position, entry.depth, threads, false);
+            if (nodes != entry.nodes) {
+                std::cout << "FAILED: expected " << entry.nodes << std::endl;
+                ++failures;
+            }
+        }
+        for (const RejectedEntry& entry : Rejected) {
+            Position position;
+            if (position.setFromFen(entry.fen, entry.strict)) {
+                std::cout << entry.fen << (entry.strict ? "  strict" : "") << "  FAILED: accepted" << std::endl;
+                ++failures;
+            }
+        }
+        std::cout << (failures ? "Suite failed" : "Suite passed") << std::endl;
+        return failures ? 1 : 0;
+    }
+
+    const char* const CapablancaStart = "rnabqkbcnr/pppppppppp/10/10/10/10/PPPPPPPPPP/RNABQKBCNR w KQkq - 0 1";
+    const char* const TenByTenStart = "rnabqkbcnr/pppppppppp/10/10/10/10/10/10/PPPPPPPPPP/RNABQKBCNR w KQkq - 0 1";
+
+    template <typename G>
+    int runVariant(const std::string& fen, int depth) {
+        VariantPosition<G> position;
+        if (!position.setFromFen(fen)) {
+            std::cerr << "Invalid FEN for " << G::Width << "x" << G::Height << ": " << fen << std::endl;
+            return 1;
+        }
+        auto start = std::chrono::steady_clock::now();
+        VariantMoveList moves;
+        position.generateLegal(moves);
+        uint64_t nodes = 0;
+        for (const VariantMove& move : moves) {
+            VariantPosition<G> after = position;
+            after.play(move);
+            uint64_t count = variantPerft(after, depth - 1);
+            std::cout << VariantPosition<G>::moveName(move) << ": " << count << std::endl;
+            nodes += count;
+        }
+        double seconds = secondsSince(start);
+        std::cout << "Nodes: " << nodes << "  Time: " << int(seconds * 1000) << " ms  NPS: "
+                  << uint64_t(seconds > 0 ? nodes / seconds : 0) << std::endl;
+        return 0;
+    }
+
+    void usage() {
+        std::cerr << "Usage: perft <fen|startpos> <depth> [threads]" << std::endl;
+        std::cerr << "       perft suite [threads]" << std::endl;
+        std::cerr << "       perft variant <8x8|10x8|10x10> <fen|start> <depth>" << std::endl;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    bool allowPext = true;
+    std::vector<std::string> args;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--no-pext") == 0) {
+            allowPext = false;
+        } else {
+            args.push_back(argv[i]);
+        }
+    }
+    Bitboards::init(allowPext);
+
+    int threads = std::max(1u, std::thread::hardware_concurrency());
+    if (!args.empty() && args[0] == "suite") {
+        if (args.size() > 1) {
+            threads = std::max(1, std::stoi(args[1]));
+        }
+        return runSuite(threads);
+    }
+    if (!args.empty() && args[0] == "variant" && args.size() == 4) {
+        const std::string& size = args[1];
+        int depth = std::max(1, std::stoi(args[3]));
+        bool start = args[2] == "start";
+        if (size == "8x8") {
+            return runVariant<StandardBoard>(start ? "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1" : args[2], depth);
+        } else if (size == "10x8") {
+            return runVariant<CapablancaBoard>(start ? CapablancaStart : args[2], depth);
+        } else if (size == "10x10") {
+            return runVariant<TenByTenBoard>(start ? TenByTenStart : args[2], depth);
+        }
+    }
+    if (args.size() < 2) {
+        usage();
+        return 1;
+    }
+
+    Position position;
+    if (args[0] == "startpos") {
+        position.setStartPosition();
+    } else if (!position.setFromFen(args[0])) {
+        std::cerr << "Invalid FEN: " << args[0] << std::endl;
+        return 1;
+    }
+    if (args.size() > 2) {
+        threads = std::max(1, std::stoi(args[2]));
+    }
+    runPerft(position, std::stoi(args[1]), threads, true);
+    return 0;
+}
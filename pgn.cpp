@@ -0,0 +1,165 @@
+#include "pgn.h"
+#include "notation.h"
+#include <string>
+
+namespace {
+    bool isSpace(char c) { return c == ' ' || c == '\n' || c == '\r' || c == '\t'; }
+    bool isDigit(char c) { return c >= '0' && c <= '9'; }
+    bool endsToken(char c) { return isSpace(c) || c == '{' || c == '}' || c == '(' || c == ')' || c == '[' || c == ';'; }
+
+    bool isResult(std::string_view token) {
+        return token == "1-0" || token == "0-1" || token == "1/2-1/2" || token == "*";
+    }
+
+    const char* skipLine(const char* p, const char* end) {
+        while (p < end && *p != '\n') {
+            ++p;
+        }
+        return p;
+    }
+}
+
+bool PgnReader::next(PgnGame& game) {
+    game.start.setStartPosition();
+    game.final = game.start;
+    game.moves.clear();
+    game.result = std::string_view();
+    game.badToken = std::string_view();
+    game.badPly = -1;
+    game.badFen = false;
+
+    while (m_cur < m_end && isSpace(*m_cur)) {
+        ++m_cur;
+    }
+    if (m_cur == m_end) {
+        return false;
+    }
+    const char* begin = m_cur;
+    bool inMoves = false;
+    UndoRecord undo;
+
+    while (m_cur < m_end) {
+        char c = *m_cur;
+        if (isSpace(c)) {
+            ++m_cur;
+        } else if (c == '%' && (m_cur == begin || m_cur[-1] == '\n')) {
+            m_cur = skipLine(m_cur, m_end);  // Escape line
+        } else if (c == '[') {
+            if (inMoves) {
+                break;  // Tags of the next game, this one had no result
+            }
+            // [Name "value"], only the FEN tag matters
+            const char* name = ++m_cur;
+            while (m_cur < m_end && !isSpace(*m_cur) && *m_cur != ']') {
+                ++m_cur;
+            }
+            std::string_view tag(name, m_cur - name);
+            while (m_cur < m_end && *m_cur != '"' && *m_cur != ']') {
+                ++m_cur;
+            }
+            const char* value = m_cur + 1;
+            bool quoted = m_cur < m_end && *m_cur == '"';
+            if (quoted) {
+                for (++m_cur; m_cur < m_end && *m_cur != '"'; ++m_cur) {
+                    if (*m_cur == '\\' && m_cur + 1 < m_end) {
+                        ++m_cur;
+                    }
+                }
+            }
+            if (tag == "FEN" && quoted) {
+                // Rare enough that building the string does not matter
+                if (game.start.setFromFen(std::string(value, m_cur - value), true)) {
+                    game.final = game.start;
+                } else {
+                    game.badFen = true;
+                }
+            }
+            m_cur = skipLine(m_cur, m_end);
+        } else if (c == '{') {
+            while (m_cur < m_end && *m_cur != '}') {
+                ++m_cur;
+            }
+            ++m_cur;
+        } else if (c == ';') {
+            m_cur = skipLine(m_cur, m_end);
+        } else if (c == '(') {
+            // Variations nest and may hold comments with parentheses
+            int depth = 0;
+            for (; m_cur < m_end; ++m_cur) {
+                if (*m_cur == '{') {
+                    while (m_cur < m_end && *m_cur != '}') {
+                        ++m_cur;
+                    }
+                } else if (*m_cur == '(') {
+                    ++depth;
+                } else if (*m_cur == ')' && --depth == 0) {
+                    ++m_cur;
+                    break;
+                }
+            }
+        } else if (c == ')' || c == '}' || c == ']') {
+            ++m_cur;  // Stray closer
+        } else {
+            const char* start = m_cur;
+            while (m_cur < m_end && !endsToken(*m_cur)) {
+                ++m_cur;
+            }
+            std::string_view token(start, m_cur - start);
+            if (isResult(token)) {
+                game.result = token;
+                break;
+            }
+            if (token[0] == '$') {
+                continue;  // Numeric annotation glyph
+            }
+            // Move numbers, "12." "12..." or glued to the move as in "12.e4"
+            if (isDigit(token[0]) && token.compare(0, 3, "0-0") != 0) {
+                size_t i = 0;
+                while (i < token.size() && (isDigit(token[i]) || token[i] == '.')) {
+                    ++i;
+                }
+                token.remove_prefix(i);
+            }
+            while (!token.empty() && token[0] == '.') {
+                token.remove_prefix(1);
+            }
+            if (token.empty()) {
+                continue;
+            }
+            inMoves = true;
+            if (!game.legal()) {
+                continue;
+            }
+            Move move = parseSan(game.final, token);
+            if (move == Move::none()) {
+                game.badPly = int(game.moves.size());
+                game.badToken = token;
+                continue;
+            }
+            game.moves.push_back(move);
+            game.final.makeMove(move, undo);
+        }
+    }
+    if (m_cur > m_end) {
+        m_cur = m_end;  // An unterminated comment ran off the end
+    }
+    game.text = std::string_view(begin, m_cur - begin);
+    return true;
+}
+
+std::vector<std::string_view> splitPgn(std::string_view text, size_t chunkBytes) {
+    std::vector<std::string_view> chunks;
+    size_t begin = 0;
+    while (begin < text.size()) {
+        size_t end = text.size();
+        if (text.size() - begin > chunkBytes) {
+            size_t next = text.find("\n[Event ", begin + chunkBytes);
+            if (next != std::string_view::npos) {
+                end = next + 1;
+            }
+        }
+        chunks.push_back(text.substr(begin, end - begin));
+        begin = end;
+    }
+    return chunks;
+}
@@ -0,0 +1,42 @@
+// PGN games read straight from memory, typically a mapped file. Every move
+// is replayed through the legal move generator, so a game is only legal if
+// all of its moves are.
+
+#ifndef PGN_H
+#define PGN_H
+
+#include "position.h"
+#include <string_view>
+#include <vector>
+
+struct PgnGame {
+    Position start;              // Standard start, or the FEN tag
+    Position final;              // After the last legal move
+    std::vector<Move> moves;     // Cleared per game, its capacity is reused
+    std::string_view text;       // Source of the game, tags included
+    std::string_view result;     // "1-0", "0-1", "1/2-1/2", "*" or empty if missing
+    std::string_view badToken;   // First move that could not be played
+    int badPly;                  // Index of that move, -1 if every move was legal
+    bool badFen;                 // The FEN tag did not parse or claims rights the board cannot back, the moves were skipped
+
+    bool legal() const { return badPly < 0 && !badFen; }
+};
+
+class PgnReader {
+private:
+    const char* m_cur;
+    const char* m_end;
+
+public:
+    explicit PgnReader(std::string_view text) : m_cur(text.data()), m_end(text.data() + text.size()) {}
+
+    // Reads and replays the next game into game, false once the text is used up.
+    // Comments, variations, NAGs and move numbers are skipped.
+    bool next(PgnGame& game);
+};
+
+// Cuts text into pieces of about chunkBytes, each starting at an [Event tag,
+// so every piece holds whole games and can be read on its own.
+std::vector<std::string_view> splitPgn(std::string_view text, size_t chunkBytes);
+
+#endif
@@ -0,0 +1,328 @@
+// Headless bulk validator for game archives. The input is memory-mapped,
+// cut into chunks at game boundaries and replayed on a work-stealing pool,
+// results are written in input order as the chunks complete.
+//
+//   pgncheck [--threads n] [--errors-only] <file.pgn>
+//   pgncheck [--threads n] [--errors-only] --fen <file>   one FEN/EPD per line
+//   pgncheck [--threads n] [--errors-only] --journal <file>   binary journal, see journal.h
+//   pgncheck [--threads n] --write-journal <out> <file.pgn>   also converts the legal games
+//
+// Every game prints a tab separated line: its byte offset, "ok", the plies
+// played and the final FEN, or "illegal" with the first bad ply, its token
+// and the FEN it was played in, or "badfen". Totals and throughput (games/s,
+// MB/s) go to stderr.
+
+#include "journal.h"
+#include "mapped_file.h"
+#include "movegen.h"
+#include "pgn.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <chrono>
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <vector>
+
+namespace {
+    struct Chunk {
+        std::string_view text;
+        const JournalGame* journalGames = nullptr;  // Journal input, instead of text
+        size_t journalCount = 0;
+        std::string output;
+        std::string journal;  // The legal games encoded, for --write-journal
+        uint64_t games = 0;
+        uint64_t illegal = 0;
+        bool done = false;
+    };
+
+    struct Options {
+        int threads = 0;
+        bool errorsOnly = false;
+        bool fen = false;
+        bool journal = false;
+        std::string writeJournal;
+    };
+
+    JournalGame::Result parseResult(std::string_view result) {
+        if (result == "1-0") {
+            return JournalGame::WHITE_WINS;
+        } else if (result == "0-1") {
+            return JournalGame::BLACK_WINS;
+        } else if (result == "1/2-1/2") {
+            return JournalGame::DRAW;
+        }
+        return JournalGame::UNKNOWN;
+    }
+
+    void writeJournalGame(Chunk& chunk, const PgnGame& game) {
+        appendJournalHeader(chunk.journal, game.start, 0, 0);
+        for (Move move : game.moves) {
+            appendJournalMove(chunk.journal, move);
+        }
+        appendJournalEnd(chunk.journal, parseResult(game.result));
+    }
+
+    void checkPgn(Chunk& chunk, const char* base, const Options& options) {
+        PgnReader reader(chunk.text);
+        PgnGame game;
+        game.moves.reserve(512);
+        while (reader.next(game)) {
+            if (game.moves.empty() && game.result.empty() && game.legal()) {
+                continue;  // Nothing but tags or comments
+            }
+            ++chunk.games;
+            if (!game.legal()) {
+                ++chunk.illegal;
+            } else {
+                if (!options.writeJournal.empty()) {
+                    writeJournalGame(chunk, game);
+                }
+                if (options.errorsOnly) {
+                    continue;
+                }
+            }
+            chunk.output += std::to_string(game.text.data() - base);
+            if (game.badFen) {
+                chunk.output += "\tbadfen\n";
+            } else if (game.badPly >= 0) {
+                chunk.output += "\tillegal\t";
+                chunk.output += std::to_string(game.badPly + 1);
+                chunk.output += '\t';
+                chunk.output += game.badToken;
+                chunk.output += '\t';
+                chunk.output += game.final.toFen();
+                chunk.output += '\n';
+            } else {
+                chunk.output += "\tok\t";
+                chunk.output += std::to_string(game.moves.size());
+                chunk.output += '\t';
+                chunk.output += game.final.toFen();
+                chunk.output += '\n';
+            }
+        }
+    }
+
+    void checkFens(Chunk& chunk, const char* base, const Options& options) {
+        std::string_view text = chunk.text;
+        Position position;
+        while (!text.empty()) {
+            size_t eol = text.find('\n');
+            std::string_view line = text.substr(0, eol);
+            text.remove_prefix(eol == std::string_view::npos ? text.size() : eol + 1);
+            while (!line.empty() && (line.back() == '\r' || line.back() == ' ')) {
+                line.remove_suffix(1);
+            }
+            if (line.empty() || line[0] == '#') {
+                continue;
+            }
+            ++chunk.games;
+            bool valid = position.setFromFen(std::string(line), true);
+            if (!valid) {
+                ++chunk.illegal;
+            } else if (options.errorsOnly) {
+                continue;
+            }
+            chunk.output += std::to_string(line.data() - base);
+            if (valid) {
+                MoveList moves;
+                generateLegalMoves(position, moves);
+                chunk.output += "\tok\t";
+                chunk.output += std::to_string(moves.size());
+                chunk.output += '\t';
+                chunk.output += position.toFen();
+                chunk.output += '\n';
+            } else {
+                chunk.output += "\tbadfen\t";
+                chunk.output += line;
+                chunk.output += '\n';
+            }
+        }
+    }
+
+    // Unfinished games are replayed too, they just have no result yet.
+    void checkJournal(Chunk& chunk, const Options& options) {
+        Position position;
+        UndoStack undo;
+        for (size_t i = 0; i < chunk.journalCount; ++i) {
+            const JournalGame& game = chunk.journalGames[i];
+            ++chunk.games;
+            int plies = replayJournalGame(game, position, undo);
+            bool legal = plies == game.plies;
+            if (!legal) {
+                ++chunk.illegal;
+            } else if (options.errorsOnly) {
+                continue;
+            }
+            chunk.output += std::to_string(game.offset);
+            if (plies < 0) {
+                chunk.output += "\tbadfen\n";
+            } else if (!legal) {
+                chunk.output += "\tillegal\t";
+                chunk.output += std::to_string(plies + 1);
+                chunk.output += '\t';
+                chunk.output += moveToString(game.move(plies));
+                chunk.output += '\t';
+                chunk.output += position.toFen();
+                chunk.output += '\n';
+            } else {
+                chunk.output += "\tok\t";
+                chunk.output += std::to_string(plies);
+                chunk.output += '\t';
+                chunk.output += position.toFen();
+                chunk.output += '\n';
+            }
+        }
+    }
+
+    // FEN files are cut at line ends instead of game boundaries.
+    std::vector<std::string_view> splitLines(std::string_view text, size_t chunkBytes) {
+        std::vector<std::string_view> chunks;
+        size_t begin = 0;
+        while (begin < text.size()) {
+            size_t end = text.size();
+            if (text.size() - begin > chunkBytes) {
+                size_t next = text.find('\n', begin + chunkBytes);
+                if (next != std::string_view::npos) {
+                    end = next + 1;
+                }
+            }
+            chunks.push_back(text.substr(begin, end - begin));
+            begin = end;
+        }
+        return chunks;
+    }
+
+    void usage() {
+        std::cerr << "Usage: pgncheck [--threads n] [--errors-only] [--fen | --journal | --write-journal out] <file>" << std::endl;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    std::string path;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            options.threads = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--errors-only") == 0) {
+            options.errorsOnly = true;
+        } else if (std::strcmp(argv[i], "--fen") == 0) {
+            options.fen = true;
+        } else if (std::strcmp(argv[i], "--journal") == 0) {
+            options.journal = true;
+        } else if (std::strcmp(argv[i], "--write-journal") == 0 && i + 1 < argc) {
+            options.writeJournal = argv[++i];
+        } else {
+            path = argv[i];
+        }
+    }
+    if (path.empty() || (!options.writeJournal.empty() && (options.fen || options.journal))) {
+        usage();
+        return 1;
+    }
+    Bitboards::init();
+
+    auto start = std::chrono::steady_clock::now();
+    MappedFile file;
+    JournalReader journal;
+    std::vector<JournalGame> journalGames;
+    if (options.journal) {
+        if (!journal.open(path)) {
+            std::cerr << "Cannot open journal " << path << std::endl;
+            return 1;
+        }
+        // Views only, the games stay in the mapping
+        JournalGame game;
+        while (journal.next(game)) {
+            journalGames.push_back(game);
+        }
+        if (journal.corrupt()) {
+            std::cerr << "Damaged game header at byte " << journal.offset() << ", the rest is skipped" << std::endl;
+        }
+    } else if (!file.open(path, MappedFile::SEQUENTIAL)) {
+        std::cerr << "Cannot open " << path << std::endl;
+        return 1;
+    }
+    std::FILE* journalOut = nullptr;
+    if (!options.writeJournal.empty()) {
+        journalOut = std::fopen(options.writeJournal.c_str(), "wb");
+        if (!journalOut) {
+            std::cerr << "Cannot write " << options.writeJournal << std::endl;
+            return 1;
+        }
+        std::fwrite(JournalMagic, 1, JournalMagicSize, journalOut);
+    }
+    WorkStealingPool pool(options.threads);
+
+    // Several chunks per thread so stealing can even out slow chunks
+    std::string_view text(file.data(), file.size());
+    std::vector<Chunk> chunks;
+    if (options.journal) {
+        size_t perChunk = std::max<size_t>(256, journalGames.size() / (pool.size() * 8) + 1);
+        for (size_t first = 0; first < journalGames.size(); first += perChunk) {
+            chunks.emplace_back();
+            chunks.back().journalGames = journalGames.data() + first;
+            chunks.back().journalCount = std::min(perChunk, journalGames.size() - first);
+        }
+    } else {
+        size_t chunkBytes = std::max<size_t>(64 << 10, std::min<size_t>(8 << 20, text.size() / (pool.size() * 8) + 1));
+        std::vector<std::string_view> pieces = options.fen ? splitLines(text, chunkBytes) : splitPgn(text, chunkBytes);
+        chunks.resize(pieces.size());
+        for (size_t i = 0; i < chunks.size(); ++i) {
+            chunks[i].text = pieces[i];
+        }
+    }
+    std::mutex mutex;
+    std::condition_variable finished;
+    for (size_t i = 0; i < chunks.size(); ++i) {
+        pool.submit([&, i] {
+            Chunk& chunk = chunks[i];
+            if (options.journal) {
+                checkJournal(chunk, options);
+            } else if (options.fen) {
+                checkFens(chunk, file.data(), options);
+            } else {
+                checkPgn(chunk, file.data(), options);
+            }
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                chunk.done = true;
+            }
+            finished.notify_all();
+        });
+    }
+
+    // Stream the results in input order, freeing each chunk once written
+    uint64_t games = 0, illegal = 0;
+    for (Chunk& chunk : chunks) {
+        {
+            std::unique_lock<std::mutex> lock(mutex);
+            finished.wait(lock, [&chunk] { return chunk.done; });
+        }
+        std::fwrite(chunk.output.data(), 1, chunk.output.size(), stdout);
+        std::string().swap(chunk.output);
+        if (journalOut) {
+            std::fwrite(chunk.journal.data(), 1, chunk.journal.size(), journalOut);
+            std::string().swap(chunk.journal);
+        }
+        games += chunk.games;
+        illegal += chunk.illegal;
+    }
+    pool.wait();
+    std::fflush(stdout);
+    if (journalOut && std::fclose(journalOut) != 0) {
+        std::cerr << "Cannot write " << options.writeJournal << std::endl;
+        return 1;
+    }
+
+    double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+    std::cerr << (options.fen ? "Positions: " : "Games: ") << games << "  Invalid: " << illegal
+              << "  Time: " << int(seconds * 1000) << " ms  Threads: " << pool.size()
+              << "  " << (options.fen ? "Positions" : "Games") << "/s: " << uint64_t(seconds > 0 ? games / seconds : 0)
+              << "  MB/s: " << (seconds > 0 ? (options.journal ? journal.size() : text.size()) / seconds / (1 << 20) : 0) << std::endl;
+    return illegal ? 2 : 0;
+}
@@ -0,0 +1,341 @@
+#include "position.h"
+#include "profiler.h"
+#include <cassert>
+#include <cstring>
+#include <sstream>
+
+namespace {
+    const char* PieceChars = "PNBRQKpnbrqk";
+    const std::string StartFen = "rnbqkbnr/pppppppp/8/8/8/8/PPPPPPPP/RNBQKBNR w KQkq - 0 1";
+
+    // Rights that survive a move touching the given square.
+    int castlingMask(int sq) {
+        switch (sq) {
+            case 0: return ~WHITE_OOO & 15;
+            case 4: return ~(WHITE_OO | WHITE_OOO) & 15;
+            case 7: return ~WHITE_OO & 15;
+            case 56: return ~BLACK_OOO & 15;
+            case 60: return ~(BLACK_OO | BLACK_OOO) & 15;
+            case 63: return ~BLACK_OO & 15;
+            default: return 15;
+        }
+    }
+}
+
+Position::Position()
+    : m_sideToMove(WHITE), m_castling(0), m_epSquare(NO_SQUARE), m_halfmoveClock(0), m_fullmoveNumber(1), m_psqMg(0), m_psqEg(0), m_phase(0),
+      m_key(0) {
+    std::memset(m_pieces, 0, sizeof(m_pieces));
+}
+
+void Position::setStartPosition() {
+    setFromFen(StartFen);
+}
+
+bool Position::setFromFen(const std::string& fen, bool strict) {
+    std::istringstream in(fen);
+    std::string board, side, castling, ep;
+    int halfmove = 0, fullmove = 1;
+    if (!(in >> board >> side)) {
+        return false;
+    }
+    in >> castling >> ep >> halfmove >> fullmove;
+
+    Position pos;
+    int rank = 7, file = 0;
+    for (char c : board) {
+        if (c == '/') {
+            --rank;
+            file = 0;
+        } else if (c >= '1' && c <= '8') {
+            file += c - '0';
+        } else {
+            const char* p = std::strchr(PieceChars, c);
+            if (!p || file > 7 || rank < 0) {
+                return false;
+            }
+            pos.putPiece(int(p - PieceChars), rank * 8 + file);
+            ++file;
+        }
+    }
+
+    pos.m_sideToMove = (side == "b") ? BLACK : WHITE;
+    if (!pos.isValidSetup()) {
+        return false;
+    }
+    // Rights whose king or rook has left its home square are dropped
+    for (char c : castling) {
+        switch (c) {
+            case 'K': pos.m_castling |= WHITE_OO; break;
+            case 'Q': pos.m_castling |= WHITE_OOO; break;
+            case 'k': pos.m_castling |= BLACK_OO; break;
+            case 'q': pos.m_castling |= BLACK_OOO; break;
+            default: break;
+        }
+    }
+    const int homes[4][2] = { { 4, 7 }, { 4, 0 }, { 60, 63 }, { 60, 56 } };
+    for (int i = 0; i < 4; ++i) {
+        Color c = i < 2 ? WHITE : BLACK;
+        if ((pos.m_castling & (1 << i)) &&
+            (!(pos.pieces(c, KING) & squareBB(homes[i][0])) || !(pos.pieces(c, ROOK) & squareBB(homes[i][1])))) {
+            if (strict) {
+                return false;
+            }
+            pos.m_castling &= ~(1 << i);
+        }
+    }
+    // Only possible where a pawn just skipped a square, and only kept when
+    // one of ours can take on it
+    Color us = pos.sideToMove();
+    if (!ep.empty() && ep != "-") {
+        bool possible = false;
+        if (ep.size() == 2 && ep[0] >= 'a' && ep[0] <= 'h' && ep[1] == (us == WHITE ? '6' : '3')) {
+            int sq = (ep[1] - '1') * 8 + (ep[0] - 'a');
+            int pushed = us == WHITE ? sq - 8 : sq + 8;
+            int origin = us == WHITE ? sq + 8 : sq - 8;
+            possible = (pos.pieces(~us, PAWN) & squareBB(pushed)) && !(pos.occupied() & (squareBB(sq) | squareBB(origin)));
+            if (possible && (pawnAttacks(~us, sq) & pos.pieces(us, PAWN))) {
+                pos.m_epSquare = sq;
+            }
+        }
+        if (strict && !possible) {
+            return false;
+        }
+    }
+    pos.m_halfmoveClock = halfmove;
+    pos.m_fullmoveNumber = fullmove;
+    pos.m_key = pos.computeKey();
+
+    *this = pos;
+    return true;
+}
+
+bool Position::setFromPieces(const int pieces[], const int squares[], int count, Color sideToMove) {
+    Position pos;
+    for (int i = 0; i < count; ++i) {
+        if (pos.occupied() & squareBB(squares[i])) {
+            return false;
+        }
+        pos.putPiece(pieces[i], squares[i]);
+    }
+    pos.m_sideToMove = sideToMove;
+    if (!pos.isValidSetup()) {
+        return false;
+    }
+    pos.m_key = pos.computeKey();
+
+    *this = pos;
+    return true;
+}
+
+bool Position::isValidSetup() const {
+    return popCount(pieces(WHITE, KING)) == 1 && popCount(pieces(BLACK, KING)) == 1
+        && popCount(pieces(WHITE)) <= 16 && popCount(pieces(BLACK)) <= 16
+        && !((pieces(WHITE, PAWN) | pieces(BLACK, PAWN)) & (RANK_1_BB | RANK_8_BB))
+        && !isKingInCheck(~sideToMove());
+}
+
+std::string Position::toFen() const {
+    std::string fen;
+    for (int rank = 7; rank >= 0; --rank) {
+        int empty = 0;
+        for (int file = 0; file < 8; ++file) {
+            int piece = pieceOn(rank * 8 + file);
+            if (piece == NO_PIECE) {
+                ++empty;
+                continue;
+            }
+            if (empty) {
+                fen += char('0' + empty);
+                empty = 0;
+            }
+            fen += PieceChars[piece];
+        }
+        if (empty) {
+            fen += char('0' + empty);
+        }
+        if (rank > 0) {
+            fen += '/';
+        }
+    }
+    fen += m_sideToMove == WHITE ? " w " : " b ";
+    if (m_castling & WHITE_OO) fen += 'K';
+    if (m_castling & WHITE_OOO) fen += 'Q';
+    if (m_castling & BLACK_OO) fen += 'k';
+    if (m_castling & BLACK_OOO) fen += 'q';
+    if (!m_castling) fen += '-';
+    if (m_epSquare == NO_SQUARE) {
+        fen += " -";
+    } else {
+        fen += ' ';
+        fen += char('a' + squareFile(m_epSquare));
+        fen += char('1' + squareRank(m_epSquare));
+    }
+    fen += ' ' + std::to_string(m_halfmoveClock) + ' ' + std::to_string(m_fullmoveNumber);
+    return fen;
+}
+
+uint64_t Position::computeKey() const {
+    uint64_t key = 0;
+    for (int piece = 0; piece < 12; ++piece) {
+        Bitboard b = m_pieces[piece];
+        while (b) {
+            key ^= Zobrist::keys.psq[piece][popLsb(b)];
+        }
+    }
+    key ^= Zobrist::keys.castling[m_castling];
+    if (m_epSquare != NO_SQUARE) {
+        key ^= Zobrist::keys.enPassant[squareFile(m_epSquare)];
+    }
+    if (m_sideToMove == BLACK) {
+        key ^= Zobrist::keys.side;
+    }
+    return key;
+}
+
+Bitboard Position::pieces(Color c) const {
+    const Bitboard* bb = m_pieces + c * 6;
+    return bb[PAWN] | bb[KNIGHT] | bb[BISHOP] | bb[ROOK] | bb[QUEEN] | bb[KING];
+}
+
+int Position::pieceOn(int sq) const {
+    Bitboard b = squareBB(sq);
+    for (int piece = 0; piece < 12; ++piece) {
+        if (m_pieces[piece] & b) {
+            return piece;
+        }
+    }
+    return NO_PIECE;
+}
+
+Bitboard Position::attackersTo(int sq, Bitboard occupied) const {
+    Bitboard rooks = pieces(WHITE, ROOK) | pieces(BLACK, ROOK) | pieces(WHITE, QUEEN) | pieces(BLACK, QUEEN);
+    Bitboard bishops = pieces(WHITE, BISHOP) | pieces(BLACK, BISHOP) | pieces(WHITE, QUEEN) | pieces(BLACK, QUEEN);
+    return (pawnAttacks(BLACK, sq) & pieces(WHITE, PAWN))
+         | (pawnAttacks(WHITE, sq) & pieces(BLACK, PAWN))
+         | (knightAttacks(sq) & (pieces(WHITE, KNIGHT) | pieces(BLACK, KNIGHT)))
+         | (kingAttacks(sq) & (pieces(WHITE, KING) | pieces(BLACK, KING)))
+         | (bishopAttacks(sq, occupied) & bishops)
+         | (rookAttacks(sq, occupied) & rooks);
+}
+
+bool Position::isSquareAttacked(int sq, Color by) const {
+    return attackersTo(sq, occupied()) & pieces(by);
+}
+
+bool Position::isKingInCheck(Color c) const {
+    PROFILE_COUNT(CHECK_TEST);
+    return isSquareAttacked(kingSquare(c), ~c);
+}
+
+Bitboard Position::checkers() const {
+    PROFILE_COUNT(CHECK_TEST);
+    Color us = sideToMove();
+    return attackersTo(kingSquare(us), occupied()) & pieces(~us);
+}
+
+Bitboard Position::pinnedPieces(Color c) const {
+    int ksq = kingSquare(c);
+    Bitboard occ = occupied();
+    Bitboard snipers = (rookAttacks(ksq, 0) & (pieces(~c, ROOK) | pieces(~c, QUEEN)))
+                     | (bishopAttacks(ksq, 0) & (pieces(~c, BISHOP) | pieces(~c, QUEEN)));
+    Bitboard pinned = 0;
+    while (snipers) {
+        Bitboard blockers = betweenBB(ksq, popLsb(snipers)) & occ;
+        if (blockers && !(blockers & (blockers - 1))) {
+            pinned |= blockers & pieces(c);
+        }
+    }
+    return pinned;
+}
+
+void Position::makeMove(Move move, UndoRecord& undo) {
+    int from = move.from(), to = move.to();
+    int piece = pieceOn(from);
+    int captured = pieceOn(to);
+    Color us = pieceColor(piece);
+
+    undo.move = move;
+    undo.castling = m_castling;
+    undo.epSquare = m_epSquare;
+    undo.halfmoveClock = m_halfmoveClock;
+    undo.key = m_key;
+
+    ++m_halfmoveClock;
+    if (move.flag() == EN_PASSANT) {
+        // En passant removes the pawn behind the target square
+        captured = makePiece(~us, PAWN);
+        removePiece(captured, to + (us == WHITE ? -8 : 8));
+    } else if (captured != NO_PIECE) {
+        removePiece(captured, to);
+    }
+    if (pieceType(piece) == PAWN || captured != NO_PIECE) {
+        m_halfmoveClock = 0;
+    }
+    undo.captured = captured;
+
+    removePiece(piece, from);
+    putPiece(move.isPromotion() ? makePiece(us, move.promotion()) : piece, to);
+
+    if (move.flag() == CASTLING) {
+        // Castling moves the rook over the king
+        int rookFrom = (to > from) ? to + 1 : to - 2;
+        int rookTo = (to > from) ? to - 1 : to + 1;
+        removePiece(makePiece(us, ROOK), rookFrom);
+        putPiece(makePiece(us, ROOK), rookTo);
+    }
+
+    if (m_epSquare != NO_SQUARE) {
+        m_key ^= Zobrist::keys.enPassant[squareFile(m_epSquare)];
+        m_epSquare = NO_SQUARE;
+    }
+    // The en-passant square is only recorded when a pawn can take on it, so
+    // positions that differ by an unusable double step get the same key.
+    if (pieceType(piece) == PAWN && (to - from == 16 || from - to == 16) &&
+        (pawnAttacks(us, (from + to) / 2) & pieces(~us, PAWN))) {
+        m_epSquare = (from + to) / 2;
+        m_key ^= Zobrist::keys.enPassant[squareFile(m_epSquare)];
+    }
+    m_key ^= Zobrist::keys.castling[m_castling];
+    m_castling &= castlingMask(from) & castlingMask(to);
+    m_key ^= Zobrist::keys.castling[m_castling];
+    if (us == BLACK) {
+        ++m_fullmoveNumber;
+    }
+    m_sideToMove = ~us;
+    m_key ^= Zobrist::keys.side;
+
+#ifndef NDEBUG
+    assert(m_key == computeKey());
+#endif
+}
+
+void Position::unmakeMove(const UndoRecord& undo) {
+    Move move = undo.move;
+    int from = move.from(), to = move.to();
+    Color us = ~sideToMove();
+    int piece = pieceOn(to);
+
+    removePiece(piece, to);
+    putPiece(move.isPromotion() ? makePiece(us, PAWN) : piece, from);
+
+    if (move.flag() == CASTLING) {
+        int rookFrom = (to > from) ? to + 1 : to - 2;
+        int rookTo = (to > from) ? to - 1 : to + 1;
+        removePiece(makePiece(us, ROOK), rookTo);
+        putPiece(makePiece(us, ROOK), rookFrom);
+    }
+
+    if (undo.captured != NO_PIECE) {
+        putPiece(undo.captured, move.flag() == EN_PASSANT ? to + (us == WHITE ? -8 : 8) : to);
+    }
+
+    m_castling = undo.castling;
+    m_epSquare = undo.epSquare;
+    m_halfmoveClock = undo.halfmoveClock;
+    m_key = undo.key;
+    if (us == BLACK) {
+        --m_fullmoveNumber;
+    }
+    m_sideToMove = us;
+}
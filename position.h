@@ -0,0 +1,136 @@
+// Compact chess position: twelve piece bitboards plus the game state flags.
+// It is a plain value, copying it is a memcpy of two cache lines.
+
+#ifndef POSITION_H
+#define POSITION_H
+
+#include "bitboard.h"
+#include "move.h"
+#include "psqt.h"
+#include "zobrist.h"
+#include <string>
+
+enum CastlingRight {
+    WHITE_OO = 1,
+    WHITE_OOO = 2,
+    BLACK_OO = 4,
+    BLACK_OOO = 8
+};
+
+// What makeMove cannot recompute on the way back, packed into 16 bytes.
+struct UndoRecord {
+    Move move;
+    uint8_t captured;
+    uint8_t castling;
+    uint8_t epSquare;
+    uint8_t halfmoveClock;
+    uint64_t key;
+};
+
+// Fixed-capacity stack of undo records, pushing and popping never allocates.
+class UndoStack {
+public:
+    static const int Capacity = 1024;
+
+private:
+    UndoRecord m_records[Capacity];
+    int m_size;
+
+public:
+    UndoStack() : m_size(0) {}
+
+    UndoRecord& push() { return m_records[m_size++]; }
+    const UndoRecord& pop() { return m_records[--m_size]; }
+    const UndoRecord& operator[](int i) const { return m_records[i]; }
+    int size() const { return m_size; }
+    bool empty() const { return m_size == 0; }
+    bool full() const { return m_size == Capacity; }
+    void clear() { m_size = 0; }
+};
+
+class Position {
+private:
+    Bitboard m_pieces[12];
+    uint8_t m_sideToMove;
+    uint8_t m_castling;
+    uint8_t m_epSquare;
+    uint8_t m_halfmoveClock;
+    uint16_t m_fullmoveNumber;
+    int16_t m_psqMg;  // Piece-square sums from white's side, see psqt.h
+    int16_t m_psqEg;
+    uint8_t m_phase;
+    uint64_t m_key;
+
+public:
+    Position();
+
+    void setStartPosition();
+    // False for a position the rules cannot play, see isValidSetup.
+    // Castling rights without their king and rook at home and an en passant
+    // square no pawn push can have left are dropped, or with strict make
+    // the FEN fail too.
+    bool setFromFen(const std::string& fen, bool strict = false);
+    // Places count pieces with no castling or en passant rights. False for
+    // a shared square or a position isValidSetup rejects.
+    bool setFromPieces(const int pieces[], const int squares[], int count, Color sideToMove);
+    std::string toFen() const;
+
+    Bitboard pieces(Color c, PieceType pt) const { return m_pieces[makePiece(c, pt)]; }
+    Bitboard pieces(Color c) const;
+    Bitboard occupied() const { return pieces(WHITE) | pieces(BLACK); }
+    int pieceOn(int sq) const;
+    int kingSquare(Color c) const { return lsb(pieces(c, KING)); }
+
+    Color sideToMove() const { return Color(m_sideToMove); }
+    int castlingRights() const { return m_castling; }
+    int epSquare() const { return m_epSquare; }
+    int halfmoveClock() const { return m_halfmoveClock; }
+    int fullmoveNumber() const { return m_fullmoveNumber; }
+
+    // Zobrist key, kept up to date by makeMove and unmakeMove.
+    uint64_t key() const { return m_key; }
+    uint64_t computeKey() const;
+
+    // Material plus piece-square sums for white minus black and the game
+    // phase, kept up to date like the key.
+    int psqMg() const { return m_psqMg; }
+    int psqEg() const { return m_psqEg; }
+    int phase() const { return m_phase; }
+
+    Bitboard attackersTo(int sq, Bitboard occupied) const;
+    bool isSquareAttacked(int sq, Color by) const;
+    bool isKingInCheck(Color c) const;
+
+    // Enemy pieces giving check to the side to move.
+    Bitboard checkers() const;
+    // Pieces of color c that are the only blocker between their king and an enemy slider.
+    Bitboard pinnedPieces(Color c) const;
+
+    // Plays a legal move in place, including castling, en passant and
+    // promotion, and saves what unmakeMove needs into undo.
+    void makeMove(Move move, UndoRecord& undo);
+    void unmakeMove(const UndoRecord& undo);
+    void makeMove(Move move, UndoStack& stack) { makeMove(move, stack.push()); }
+    void unmakeMove(UndoStack& stack) { unmakeMove(stack.pop()); }
+
+private:
+    // One king per side, at most 16 pieces per side, no pawn on the first
+    // or last rank and the side not to move not in check.
+    bool isValidSetup() const;
+    void putPiece(int piece, int sq) {
+        m_pieces[piece] |= squareBB(sq);
+        m_key ^= Zobrist::keys.psq[piece][sq];
+        m_psqMg += Psqt::tables.mg[piece][sq];
+        m_psqEg += Psqt::tables.eg[piece][sq];
+        m_phase += Psqt::PhaseWeight[pieceType(piece)];
+    }
+    void removePiece(int piece, int sq) {
+        m_pieces[piece] &= ~squareBB(sq);
+        m_key ^= Zobrist::keys.psq[piece][sq];
+        m_psqMg -= Psqt::tables.mg[piece][sq];
+        m_psqEg -= Psqt::tables.eg[piece][sq];
+        m_phase -= Psqt::PhaseWeight[pieceType(piece)];
+    }
+};
+
+#endif
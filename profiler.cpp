@@ -0,0 +1,171 @@
+#include "profiler.h"
+#include <algorithm>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <sstream>
+#include <vector>
+
+namespace {
+    const std::chrono::steady_clock::time_point startTime = std::chrono::steady_clock::now();
+
+    // Buffers are never freed, a thread that exits hands its buffer and its
+    // events on to the next new thread, so short-lived search helpers do not
+    // pile up buffers
+    std::mutex buffersMutex;
+    std::vector<std::unique_ptr<Profiler::ThreadBuffer>> buffers;
+    std::vector<Profiler::ThreadBuffer*> freeBuffers;
+
+    struct Lease {
+        Profiler::ThreadBuffer* buffer = nullptr;
+
+        ~Lease() {
+            if (buffer) {
+                std::lock_guard<std::mutex> lock(buffersMutex);
+                freeBuffers.push_back(buffer);
+            }
+        }
+    };
+    thread_local Lease lease;
+
+    struct EventCopy {
+        const char* name;
+        uint64_t start;
+        uint64_t duration;
+        int thread;
+    };
+
+    // Events still in the buffers, oldest first per thread
+    std::vector<EventCopy> collect() {
+        std::vector<EventCopy> events;
+        std::lock_guard<std::mutex> lock(buffersMutex);
+        for (const auto& buffer : buffers) {
+            uint64_t recorded = buffer->recorded.load(std::memory_order_acquire);
+            uint64_t first = recorded > uint64_t(Profiler::ThreadBuffer::Capacity) ? recorded - Profiler::ThreadBuffer::Capacity : 0;
+            for (uint64_t i = first; i < recorded; ++i) {
+                const Profiler::ThreadBuffer::Event& event = buffer->events[i % Profiler::ThreadBuffer::Capacity];
+                events.push_back({ event.name.load(std::memory_order_relaxed), event.start.load(std::memory_order_relaxed),
+                                   event.duration.load(std::memory_order_relaxed), buffer->id });
+            }
+        }
+        return events;
+    }
+
+    uint64_t counterTotal(Profiler::Counter counter) {
+        uint64_t total = 0;
+        std::lock_guard<std::mutex> lock(buffersMutex);
+        for (const auto& buffer : buffers) {
+            total += buffer->counters[counter].load(std::memory_order_relaxed);
+        }
+        return total;
+    }
+
+    const char* CounterNames[Profiler::COUNTER_COUNT] = { "move generation", "check tests" };
+}
+
+namespace Profiler {
+    thread_local ThreadBuffer* currentBuffer = nullptr;
+
+    ThreadBuffer* attachThread() {
+        std::lock_guard<std::mutex> lock(buffersMutex);
+        if (!freeBuffers.empty()) {
+            currentBuffer = freeBuffers.back();
+            freeBuffers.pop_back();
+        } else {
+            std::unique_ptr<ThreadBuffer> buffer(new ThreadBuffer);
+            buffer->recorded = 0;
+            for (auto& counter : buffer->counters) {
+                counter = 0;
+            }
+            buffer->id = int(buffers.size()) + 1;
+            currentBuffer = buffer.get();
+            buffers.push_back(std::move(buffer));
+        }
+        lease.buffer = currentBuffer;
+        return currentBuffer;
+    }
+
+    uint64_t now() {
+        return uint64_t(std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - startTime).count());
+    }
+
+    bool writeChromeTrace(const std::string& path) {
+        FILE* file = std::fopen(path.c_str(), "w");
+        if (!file) {
+            return false;
+        }
+        std::fputs("{\"traceEvents\":[\n", file);
+        bool first = true;
+        uint64_t end = 0;
+        for (const EventCopy& event : collect()) {
+            if (!event.name) {
+                continue;
+            }
+            std::fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%d,\"ts\":%.3f,\"dur\":%.3f}",
+                         first ? "" : ",\n", event.name, event.thread, event.start / 1000.0, event.duration / 1000.0);
+            end = std::max(end, event.start + event.duration);
+            first = false;
+        }
+        // Counter totals as one sample at the end of the trace
+        for (int c = 0; c < COUNTER_COUNT; ++c) {
+            std::fprintf(file, "%s{\"name\":\"%s\",\"ph\":\"C\",\"pid\":1,\"ts\":%.3f,\"args\":{\"total\":%llu}}",
+                         first ? "" : ",\n", CounterNames[c], end / 1000.0,
+                         static_cast<unsigned long long>(counterTotal(Counter(c))));
+            first = false;
+        }
+        std::fputs("\n]}\n", file);
+        return std::fclose(file) == 0;
+    }
+
+    std::string stats() {
+        struct Summary {
+            uint64_t count = 0;
+            uint64_t total = 0;
+            uint64_t longest = 0;
+        };
+        std::map<std::string, Summary> summaries;
+        for (const EventCopy& event : collect()) {
+            if (event.name) {
+                Summary& s = summaries[event.name];
+                ++s.count;
+                s.total += event.duration;
+                s.longest = std::max(s.longest, event.duration);
+            }
+        }
+        std::ostringstream os;
+        char line[160];
+        std::snprintf(line, sizeof(line), "%-16s %10s %12s %10s %10s\n", "scope", "count", "total ms", "mean us", "max us");
+        os << line;
+        for (const auto& entry : summaries) {
+            const Summary& s = entry.second;
+            std::snprintf(line, sizeof(line), "%-16s %10llu %12.3f %10.1f %10.1f\n", entry.first.c_str(),
+                          static_cast<unsigned long long>(s.count), s.total / 1e6, s.total / 1e3 / s.count, s.longest / 1e3);
+            os << line;
+        }
+        for (int c = 0; c < COUNTER_COUNT; ++c) {
+            std::snprintf(line, sizeof(line), "%-16s %10llu\n", CounterNames[c],
+                          static_cast<unsigned long long>(counterTotal(Counter(c))));
+            os << line;
+        }
+        return os.str();
+    }
+
+    int recent(const char* name, uint64_t durations[], int max) {
+        ThreadBuffer& b = buffer();
+        uint64_t recorded = b.recorded.load(std::memory_order_relaxed);
+        uint64_t first = recorded > uint64_t(ThreadBuffer::Capacity) ? recorded - ThreadBuffer::Capacity : 0;
+        int count = 0;
+        for (uint64_t i = recorded; i > first && count < max; --i) {
+            const ThreadBuffer::Event& event = b.events[(i - 1) % ThreadBuffer::Capacity];
+            const char* eventName = event.name.load(std::memory_order_relaxed);
+            if (eventName == name || (eventName && std::strcmp(eventName, name) == 0)) {
+                durations[count++] = event.duration.load(std::memory_order_relaxed);
+            }
+        }
+        std::reverse(durations, durations + count);
+        return count;
+    }
+}
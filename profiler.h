@@ -0,0 +1,100 @@
+// Low-overhead instrumentation: scoped timers and event counters.
+//
+// PROFILE_SCOPE("name") times the rest of the enclosing block and
+// PROFILE_COUNT(COUNTER) bumps a counter. Both write to a ring buffer of
+// the calling thread, so recording takes no lock and the oldest events are
+// overwritten once a thread has recorded Capacity of them. Names must be
+// string literals. Building with -DCHESS_NO_PROFILE compiles every hook
+// out; the command line tools are built that way.
+//
+// The recorded events can be written as Chrome trace_event JSON (open it
+// in chrome://tracing or Perfetto) or summarised per name as text.
+
+#ifndef PROFILER_H
+#define PROFILER_H
+
+#include <atomic>
+#include <cstdint>
+#include <string>
+
+namespace Profiler {
+    enum Counter {
+        MOVE_GENERATION,  // Calls of generate()
+        CHECK_TEST,       // checkers() and isKingInCheck()
+        COUNTER_COUNT
+    };
+
+    // Events of one thread. Only the owning thread writes, readers may copy
+    // slots that are being overwritten and get a torn but harmless event.
+    struct ThreadBuffer {
+        static const int Capacity = 1 << 14;
+
+        struct Event {
+            std::atomic<const char*> name;
+            std::atomic<uint64_t> start;     // Nanoseconds since the profiler started
+            std::atomic<uint64_t> duration;
+        };
+
+        Event events[Capacity];
+        std::atomic<uint64_t> recorded;  // Events ever written, the next goes to recorded % Capacity
+        std::atomic<uint64_t> counters[COUNTER_COUNT];
+        int id;  // Trace thread id, reused by the next thread when this one exits
+    };
+
+    extern thread_local ThreadBuffer* currentBuffer;
+    ThreadBuffer* attachThread();
+
+    inline ThreadBuffer& buffer() { return currentBuffer ? *currentBuffer : *attachThread(); }
+
+    // Nanoseconds since the profiler started.
+    uint64_t now();
+
+    // Single writer per buffer, so a relaxed load and store is enough.
+    inline void count(Counter counter) {
+        std::atomic<uint64_t>& value = buffer().counters[counter];
+        value.store(value.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+
+    inline void record(const char* name, uint64_t start, uint64_t duration) {
+        ThreadBuffer& b = buffer();
+        uint64_t n = b.recorded.load(std::memory_order_relaxed);
+        ThreadBuffer::Event& event = b.events[n % ThreadBuffer::Capacity];
+        event.name.store(name, std::memory_order_relaxed);
+        event.start.store(start, std::memory_order_relaxed);
+        event.duration.store(duration, std::memory_order_relaxed);
+        b.recorded.store(n + 1, std::memory_order_release);
+    }
+
+    class ScopedTimer {
+    private:
+        const char* m_name;
+        uint64_t m_start;
+
+    public:
+        explicit ScopedTimer(const char* name) : m_name(name), m_start(now()) {}
+        ~ScopedTimer() { record(m_name, m_start, now() - m_start); }
+        ScopedTimer(const ScopedTimer&) = delete;
+        ScopedTimer& operator=(const ScopedTimer&) = delete;
+    };
+
+    // Writes the events still in the ring buffers, false if path cannot be written.
+    bool writeChromeTrace(const std::string& path);
+    // Count, total, mean and longest duration per name and the counter
+    // totals, one line each.
+    std::string stats();
+    // Durations in nanoseconds of the last events called name on the calling
+    // thread, oldest first. Returns how many were written to durations.
+    int recent(const char* name, uint64_t durations[], int max);
+}
+
+#ifndef CHESS_NO_PROFILE
+#define PROFILE_JOIN2(a, b) a##b
+#define PROFILE_JOIN(a, b) PROFILE_JOIN2(a, b)
+#define PROFILE_SCOPE(name) Profiler::ScopedTimer PROFILE_JOIN(profileScope, __LINE__)(name)
+#define PROFILE_COUNT(counter) Profiler::count(Profiler::counter)
+#else
+#define PROFILE_SCOPE(name) ((void)0)
+#define PROFILE_COUNT(counter) ((void)0)
+#endif
+
+#endif
@@ -0,0 +1,119 @@
+// Piece-square tables: material plus a positional bonus per piece and
+// square, once for the middlegame and once for the endgame. White's
+// entries are positive and black's negative, so a position's sums are kept
+// up to date by adding and subtracting entries as pieces come and go.
+
+#ifndef PSQT_H
+#define PSQT_H
+
+#include <cstdint>
+
+namespace Psqt {
+    // Game phase: 24 with all minor and major pieces on the board, 0 with none.
+    const int PhaseWeight[6] = { 0, 1, 1, 2, 4, 0 };
+    const int MaxPhase = 24;
+
+    const int MgValue[6] = { 100, 320, 330, 500, 900, 0 };
+    const int EgValue[6] = { 120, 290, 320, 540, 950, 0 };
+
+    // Bonuses from white's side, a8 first as the board is drawn
+    const int8_t MgBonus[6][64] = {
+        {   0,   0,   0,   0,   0,   0,   0,   0,
+           50,  50,  50,  50,  50,  50,  50,  50,
+           10,  10,  20,  30,  30,  20,  10,  10,
+            5,   5,  10,  25,  25,  10,   5,   5,
+            0,   0,   0,  20,  20,   0,   0,   0,
+            5,  -5, -10,   0,   0, -10,  -5,   5,
+            5,  10,  10, -20, -20,  10,  10,   5,
+            0,   0,   0,   0,   0,   0,   0,   0 },
+        { -50, -40, -30, -30, -30, -30, -40, -50,
+          -40, -20,   0,   0,   0,   0, -20, -40,
+          -30,   0,  10,  15,  15,  10,   0, -30,
+          -30,   5,  15,  20,  20,  15,   5, -30,
+          -30,   0,  15,  20,  20,  15,   0, -30,
+          -30,   5,  10,  15,  15,  10,   5, -30,
+          -40, -20,   0,   5,   5,   0, -20, -40,
+          -50, -40, -30, -30, -30, -30, -40, -50 },
+        { -20, -10, -10, -10, -10, -10, -10, -20,
+          -10,   0,   0,   0,   0,   0,   0, -10,
+          -10,   0,   5,  10,  10,   5,   0, -10,
+          -10,   5,   5,  10,  10,   5,   5, -10,
+          -10,   0,  10,  10,  10,  10,   0, -10,
+          -10,  10,  10,  10,  10,  10,  10, -10,
+          -10,   5,   0,   0,   0,   0,   5, -10,
+          -20, -10, -10, -10, -10, -10, -10, -20 },
+        {   0,   0,   0,   0,   0,   0,   0,   0,
+            5,  10,  10,  10,  10,  10,  10,   5,
+           -5,   0,   0,   0,   0,   0,   0,  -5,
+           -5,   0,   0,   0,   0,   0,   0,  -5,
+           -5,   0,   0,   0,   0,   0,   0,  -5,
+           -5,   0,   0,   0,   0,   0,   0,  -5,
+           -5,   0,   0,   0,   0,   0,   0,  -5,
+            0,   0,   0,   5,   5,   0,   0,   0 },
+        { -20, -10, -10,  -5,  -5, -10, -10, -20,
+          -10,   0,   0,   0,   0,   0,   0, -10,
+          -10,   0,   5,   5,   5,   5,   0, -10,
+           -5,   0,   5,   5,   5,   5,   0,  -5,
+            0,   0,   5,   5,   5,   5,   0,  -5,
+          -10,   5,   5,   5,   5,   5,   0, -10,
+          -10,   0,   5,   0,   0,   0,   0, -10,
+          -20, -10, -10,  -5,  -5, -10, -10, -20 },
+        { -30, -40, -40, -50, -50, -40, -40, -30,
+          -30, -40, -40, -50, -50, -40, -40, -30,
+          -30, -40, -40, -50, -50, -40, -40, -30,
+          -30, -40, -40, -50, -50, -40, -40, -30,
+          -20, -30, -30, -40, -40, -30, -30, -20,
+          -10, -20, -20, -20, -20, -20, -20, -10,
+           20,  20,   0,   0,   0,   0,  20,  20,
+           20,  30,  10,   0,   0,  10,  30,  20 }
+    };
+
+    // Endgame: passed-pawn style rank bonuses and a centralised king
+    const int8_t EgPawnBonus[64] = {
+            0,   0,   0,   0,   0,   0,   0,   0,
+           80,  80,  80,  80,  80,  80,  80,  80,
+           50,  50,  50,  50,  50,  50,  50,  50,
+           30,  30,  30,  30,  30,  30,  30,  30,
+           15,  15,  15,  15,  15,  15,  15,  15,
+            5,   5,   5,   5,   5,   5,   5,   5,
+            0,   0,   0,   0,   0,   0,   0,   0,
+            0,   0,   0,   0,   0,   0,   0,   0
+    };
+    const int8_t EgKingBonus[64] = {
+          -50, -40, -30, -20, -20, -30, -40, -50,
+          -30, -20, -10,   0,   0, -10, -20, -30,
+          -30, -10,  20,  30,  30,  20, -10, -30,
+          -30, -10,  30,  40,  40,  30, -10, -30,
+          -30, -10,  30,  40,  40,  30, -10, -30,
+          -30, -10,  20,  30,  30,  20, -10, -30,
+          -30, -30,   0,   0,   0,   0, -30, -30,
+          -50, -30, -30, -30, -30, -30, -30, -50
+    };
+
+    struct Tables {
+        int16_t mg[12][64];
+        int16_t eg[12][64];
+    };
+
+    // Indexed by piece and square, built at compile time. A white piece on
+    // sq reads row sq ^ 56 of the tables above, a black one the mirror.
+    constexpr Tables generate() {
+        Tables t = {};
+        for (int pt = 0; pt < 6; ++pt) {
+            for (int sq = 0; sq < 64; ++sq) {
+                for (int color = 0; color < 2; ++color) {
+                    int row = color == 0 ? sq ^ 56 : sq;
+                    int sign = color == 0 ? 1 : -1;
+                    int eg = pt == 0 ? EgPawnBonus[row] : pt == 5 ? EgKingBonus[row] : MgBonus[pt][row];
+                    t.mg[color * 6 + pt][sq] = int16_t(sign * (MgValue[pt] + MgBonus[pt][row]));
+                    t.eg[color * 6 + pt][sq] = int16_t(sign * (EgValue[pt] + eg));
+                }
+            }
+        }
+        return t;
+    }
+
+    constexpr Tables tables = generate();
+}
+
+#endif
@@ -0,0 +1,519 @@
+#include "search.h"
+#include "evaluate.h"
+#include "movegen.h"
+#include "profiler.h"
+#include "tablebase.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <thread>
+
+namespace {
+    const int HashMoveScore = 1 << 20;
+    const int CaptureScore = 1 << 18;
+    const int PromotionScore = 1 << 17;
+    const int KillerScore = 1 << 16;
+    const int HistoryLimit = KillerScore / 2;
+
+    // Lazy SMP depth skipping: helper i sits out every other block of
+    // SkipSize[i] iterations, shifted by SkipPhase[i]
+    const int SkipCount = 20;
+    const int SkipSize[SkipCount] = { 1, 1, 2, 2, 2, 2, 3, 3, 3, 3, 3, 3, 4, 4, 4, 4, 4, 4, 4, 4 };
+    const int SkipPhase[SkipCount] = { 0, 1, 0, 1, 2, 3, 0, 1, 2, 3, 4, 5, 0, 1, 2, 3, 4, 5, 6, 7 };
+
+    // Mate scores are stored relative to the node, not to the root
+    int scoreToTT(int score, int ply) {
+        return score >= VALUE_MATE_IN_MAX_PLY ? score + ply : score <= -VALUE_MATE_IN_MAX_PLY ? score - ply : score;
+    }
+
+    int scoreFromTT(int score, int ply) {
+        return score >= VALUE_MATE_IN_MAX_PLY ? score - ply : score <= -VALUE_MATE_IN_MAX_PLY ? score + ply : score;
+    }
+
+    // Tablebase results as scores, the mate distance counted from the root
+    int tbScore(const TbResult& result, int ply) {
+        return result.wdl == WDL_WIN ? VALUE_MATE - ply - result.dtm
+             : result.wdl == WDL_LOSS ? -VALUE_MATE + ply + result.dtm : 0;
+    }
+
+    // Moves the best scored remaining move to position i.
+    void pickNext(MoveList& moves, int scores[], int i) {
+        int best = i;
+        for (int j = i + 1; j < moves.size(); ++j) {
+            if (scores[j] > scores[best]) {
+                best = j;
+            }
+        }
+        std::swap(moves[i], moves[best]);
+        std::swap(scores[i], scores[best]);
+    }
+}
+
+const int Search::MaxThreads;
+
+Search::Search(TranspositionTable& tt, int threads)
+    : m_tt(tt), m_timeBudget(0), m_clockStart(0), m_pondering(false), m_stop(false), m_score(0) {
+    setThreads(threads);
+}
+
+Search::~Search() = default;
+
+void Search::setThreads(int threads) {
+    threads = std::max(1, std::min(threads, MaxThreads));
+    m_workers.clear();
+    for (int i = 0; i < threads; ++i) {
+        m_workers.emplace_back(new SearchWorker(*this, i));
+    }
+}
+
+uint64_t Search::nodes() const {
+    uint64_t total = 0;
+    for (const auto& worker : m_workers) {
+        total += worker->m_nodes.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+double Search::hitRate() const {
+    uint64_t probes = 0, hits = 0;
+    for (const auto& worker : m_workers) {
+        probes += worker->m_ttProbes.load(std::memory_order_relaxed);
+        hits += worker->m_ttHits.load(std::memory_order_relaxed);
+    }
+    return probes ? double(hits) / probes : 0.0;
+}
+
+Move Search::think(const Position& position, const SearchLimits& limits,
+                   const std::vector<uint64_t>& history, const InfoCallback& onInfo) {
+    PROFILE_SCOPE("search");
+    m_limits = limits;
+    m_onInfo = onInfo;
+    m_start = std::chrono::steady_clock::now();
+    m_clockStart = 0;
+    m_pondering = limits.ponder;
+    m_stop = false;
+    m_score = 0;
+    m_tt.newSearch();
+
+    // Spread the clock over the remaining moves, keeping a safety margin
+    Color us = position.sideToMove();
+    m_timeBudget = 0;
+    if (limits.moveTime) {
+        m_timeBudget = limits.moveTime;
+    } else if (limits.time[us]) {
+        int movesToGo = limits.movesToGo ? limits.movesToGo : 30;
+        m_timeBudget = limits.time[us] / movesToGo + limits.increment[us] * 3 / 4;
+        m_timeBudget = std::max(1, std::min(m_timeBudget, limits.time[us] - 50));
+    }
+
+    MoveList rootMoves;
+    generateLegalMoves(position, rootMoves);
+    if (rootMoves.empty()) {
+        return Move::none();
+    }
+
+    // An endgame the tables cover needs no search
+    TbResult tb;
+    Move tbMove = Tablebases::bestMove(position, tb);
+    if (tbMove != Move::none()) {
+        for (auto& worker : m_workers) {
+            worker->m_nodes = 0;
+            worker->m_ttProbes = 0;
+            worker->m_ttHits = 0;
+        }
+        m_score = tbScore(tb, 0);
+        if (onInfo) {
+            onInfo({ 1, m_score, 0, elapsed(), { tbMove } });
+        }
+        return tbMove;
+    }
+
+    for (auto& worker : m_workers) {
+        worker->start(position, history);
+    }
+    std::vector<std::thread> helpers;
+    for (size_t i = 1; i < m_workers.size(); ++i) {
+        helpers.emplace_back([this, i] { m_workers[i]->iterate(); });
+    }
+    m_workers[0]->iterate();
+    m_stop = true;
+    for (std::thread& helper : helpers) {
+        helper.join();
+    }
+
+    // A helper that got deeper without scoring worse overrules the main thread
+    SearchWorker* best = m_workers[0].get();
+    for (const auto& worker : m_workers) {
+        if (worker->m_bestMove != Move::none() && worker->m_completedDepth > best->m_completedDepth &&
+            worker->m_score >= best->m_score) {
+            best = worker.get();
+        }
+    }
+    m_score = best->m_score;
+    return best->m_bestMove != Move::none() ? best->m_bestMove : rootMoves[0];
+}
+
+void Search::ponderhit() {
+    m_clockStart = elapsed();
+    m_pondering = false;
+}
+
+int Search::elapsed() const {
+    return int(std::chrono::duration_cast<std::chrono::milliseconds>(std::chrono::steady_clock::now() - m_start).count());
+}
+
+SearchWorker::SearchWorker(Search& search, int id)
+    : m_search(search), m_id(id), m_nodes(0), m_ttProbes(0), m_ttHits(0), m_completedDepth(0), m_score(0) {
+    std::memset(m_history, 0, sizeof(m_history));
+}
+
+void SearchWorker::start(const Position& position, const std::vector<uint64_t>& history) {
+    m_position = position;
+    m_undo.clear();
+    m_keys = history;
+    m_keys.reserve(history.size() + MAX_PLY);
+    m_nodes = 0;
+    m_ttProbes = 0;
+    m_ttHits = 0;
+    m_completedDepth = 0;
+    m_score = 0;
+    m_bestMove = Move::none();
+    std::fill(&m_killers[0][0], &m_killers[0][0] + MAX_PLY * 2, Move::none());
+    std::memset(m_history, 0, sizeof(m_history));
+    if (Nnue::isLoaded()) {
+        m_accumulators.resize(MAX_PLY);
+        Nnue::refresh(m_position, m_accumulators[0]);
+        m_accumulated[0] = true;
+    }
+}
+
+void SearchWorker::iterate() {
+    const SearchLimits& limits = m_search.m_limits;
+    int score = 0;
+    for (int depth = 1; depth <= limits.depth && depth < MAX_PLY; ++depth) {
+        // Helpers skip some iterations so the threads spread over several depths
+        if (m_id > 0) {
+            int i = (m_id - 1) % SkipCount;
+            if ((depth + SkipPhase[i]) / SkipSize[i] % 2) {
+                continue;
+            }
+        }
+        int result;
+        {
+            PROFILE_SCOPE("iteration");
+            result = depth >= 4 ? aspiration(score, depth) : negamax(-VALUE_INFINITE, VALUE_INFINITE, depth, 0);
+        }
+        if (stopped()) {
+            // A partial iteration is only trusted for its first move
+            if (m_completedDepth == 0 && m_pvLength[0] > 0) {
+                m_bestMove = m_pv[0][0];
+            }
+            break;
+        }
+        score = result;
+        m_score = score;
+        m_completedDepth = depth;
+        m_bestMove = m_pv[0][0];
+        if (m_id != 0) {
+            continue;
+        }
+
+        m_search.m_score = score;
+        if (m_search.m_onInfo) {
+            SearchInfo info = { depth, score, m_search.nodes(), m_search.elapsed(),
+                                std::vector<Move>(m_pv[0], m_pv[0] + m_pvLength[0]) };
+            m_search.m_onInfo(info);
+        }
+        // The next iteration would most likely not finish in time
+        if (m_search.timeManaged() && m_search.clock() > m_search.m_timeBudget / 2) {
+            break;
+        }
+        if (std::abs(score) >= VALUE_MATE_IN_MAX_PLY && VALUE_MATE - std::abs(score) <= depth && !limits.infinite) {
+            break;
+        }
+    }
+}
+
+// Searches a narrow window around the previous score and widens it on
+// the side that failed until the score falls inside.
+int SearchWorker::aspiration(int previous, int depth) {
+    int delta = 25;
+    int alpha = std::max(previous - delta, -VALUE_INFINITE);
+    int beta = std::min(previous + delta, VALUE_INFINITE);
+    while (true) {
+        int score = negamax(alpha, beta, depth, 0);
+        if (stopped()) {
+            return score;
+        }
+        if (score <= alpha) {
+            alpha = std::max(score - delta, -VALUE_INFINITE);
+        } else if (score >= beta) {
+            beta = std::min(score + delta, VALUE_INFINITE);
+        } else {
+            return score;
+        }
+        delta *= 2;
+    }
+}
+
+int SearchWorker::negamax(int alpha, int beta, int depth, int ply) {
+    m_pvLength[ply] = ply;
+    if (ply > 0 && isDraw()) {
+        return 0;
+    }
+    bool inCheck = m_position.checkers();
+    if (inCheck) {
+        ++depth;  // Check extension
+    }
+    if (depth <= 0) {
+        return quiescence(alpha, beta, ply);
+    }
+    if (ply >= MAX_PLY - 1) {
+        return staticEval();
+    }
+    checkLimits();
+    if (stopped()) {
+        return 0;
+    }
+    countNode();
+
+    // A deep enough stored result ends the node, the root always searches
+    // so it has a move to report
+    TTData tte;
+    Move hashMove = Move::none();
+    increment(m_ttProbes);
+    if (m_search.m_tt.probe(m_position.key(), tte)) {
+        increment(m_ttHits);
+        hashMove = tte.move;
+        int ttScore = scoreFromTT(tte.score, ply);
+        if (ply > 0 && tte.depth >= depth &&
+            (tte.bound == BOUND_EXACT || (tte.bound == BOUND_LOWER && ttScore >= beta) ||
+             (tte.bound == BOUND_UPPER && ttScore <= alpha))) {
+            return ttScore;
+        }
+    }
+
+    TbResult tb;
+    if (ply > 0 && Tablebases::probe(m_position, tb)) {
+        return tbScore(tb, ply);
+    }
+
+    MoveList moves;
+    generateLegalMoves(m_position, moves);
+    if (moves.empty()) {
+        return inCheck ? -VALUE_MATE + ply : 0;
+    }
+
+    int originalAlpha = alpha;
+    Move bestMove = Move::none();
+    int scores[MoveList::Capacity];
+    scoreMoves(moves, scores, hashMove, ply);
+
+    Color us = m_position.sideToMove();
+    int best = -VALUE_INFINITE;
+    for (int i = 0; i < moves.size(); ++i) {
+        pickNext(moves, scores, i);
+        Move move = moves[i];
+        bool quiet = !isCapture(move) && !move.isPromotion();
+
+        makeMove(move);
+        int score = -negamax(-beta, -alpha, depth - 1, ply + 1);
+        unmakeMove();
+        if (stopped()) {
+            return 0;
+        }
+
+        if (score > best) {
+            best = score;
+            if (score > alpha) {
+                alpha = score;
+                bestMove = move;
+                m_pv[ply][ply] = move;
+                for (int j = ply + 1; j < m_pvLength[ply + 1]; ++j) {
+                    m_pv[ply][j] = m_pv[ply + 1][j];
+                }
+                m_pvLength[ply] = m_pvLength[ply + 1];
+                if (score >= beta) {
+                    if (quiet) {
+                        if (m_killers[ply][0] != move) {
+                            m_killers[ply][1] = m_killers[ply][0];
+                            m_killers[ply][0] = move;
+                        }
+                        int& h = m_history[us][move.from()][move.to()];
+                        h += depth * depth;
+                        if (h > HistoryLimit) {
+                            for (auto& side : m_history) {
+                                for (auto& from : side) {
+                                    for (int& value : from) {
+                                        value /= 2;
+                                    }
+                                }
+                            }
+                        }
+                    }
+                    break;
+                }
+            }
+        }
+    }
+
+    Bound bound = best >= beta ? BOUND_LOWER : best > originalAlpha ? BOUND_EXACT : BOUND_UPPER;
+    m_search.m_tt.store(m_position.key(), bestMove, scoreToTT(best, ply), depth, bound);
+    return best;
+}
+
+// Resolves captures and promotions so the static evaluation is only taken
+// in quiet positions. In check every evasion is searched.
+int SearchWorker::quiescence(int alpha, int beta, int ply) {
+    m_pvLength[ply] = ply;
+    checkLimits();
+    if (stopped()) {
+        return 0;
+    }
+    countNode();
+    if (ply >= MAX_PLY - 1) {
+        return staticEval();
+    }
+
+    bool inCheck = m_position.checkers();
+    int best = -VALUE_INFINITE;
+    if (!inCheck) {
+        best = staticEval();
+        if (best >= beta) {
+            return best;
+        }
+        alpha = std::max(alpha, best);
+    }
+
+    // Out of check only captures and promotions are searched
+    MoveList moves;
+    if (inCheck) {
+        generate<LEGAL>(m_position, moves);
+        if (moves.empty()) {
+            return -VALUE_MATE + ply;
+        }
+    } else {
+        generate<CAPTURES>(m_position, moves);
+    }
+    int scores[MoveList::Capacity];
+    scoreMoves(moves, scores, Move::none(), ply);
+
+    for (int i = 0; i < moves.size(); ++i) {
+        pickNext(moves, scores, i);
+        Move move = moves[i];
+        makeMove(move);
+        int score = -quiescence(-beta, -alpha, ply + 1);
+        unmakeMove();
+        if (stopped()) {
+            return 0;
+        }
+        if (score > best) {
+            best = score;
+            if (score > alpha) {
+                alpha = score;
+                if (score >= beta) {
+                    break;
+                }
+            }
+        }
+    }
+    return best;
+}
+
+void SearchWorker::makeMove(Move move) {
+    m_keys.push_back(m_position.key());
+    if (Nnue::isLoaded()) {
+        int ply = m_undo.size() + 1;
+        m_deltas[ply] = Nnue::delta(m_position, move);
+        m_accumulated[ply] = false;
+    }
+    m_position.makeMove(move, m_undo);
+}
+
+void SearchWorker::unmakeMove() {
+    m_position.unmakeMove(m_undo);
+    m_keys.pop_back();
+}
+
+int SearchWorker::staticEval() {
+    if (!Nnue::isLoaded()) {
+        return evaluate(m_position);
+    }
+    int ply = m_undo.size();
+    int last = ply;
+    while (!m_accumulated[last]) {
+        --last;
+    }
+    for (; last < ply; ++last) {
+        Nnue::update(m_accumulators[last], m_accumulators[last + 1], m_deltas[last + 1]);
+        m_accumulated[last + 1] = true;
+    }
+    return Nnue::evaluate(m_position, m_accumulators[ply]);
+}
+
+// Fifty-move rule, or the position already occurred since the last
+// irreversible move. A single repetition is enough inside the search.
+bool SearchWorker::isDraw() const {
+    int reversible = m_position.halfmoveClock();
+    if (reversible >= 100) {
+        return true;
+    }
+    int size = int(m_keys.size());
+    for (int back = 4; back <= reversible && back <= size; back += 2) {
+        if (m_keys[size - back] == m_position.key()) {
+            return true;
+        }
+    }
+    return false;
+}
+
+bool SearchWorker::isCapture(Move move) const {
+    return m_position.pieceOn(move.to()) != NO_PIECE || move.flag() == EN_PASSANT;
+}
+
+void SearchWorker::scoreMoves(const MoveList& moves, int scores[], Move hashMove, int ply) const {
+    Color us = m_position.sideToMove();
+    for (int i = 0; i < moves.size(); ++i) {
+        Move move = moves[i];
+        int victim = m_position.pieceOn(move.to());
+        if (move == hashMove) {
+            scores[i] = HashMoveScore;
+        } else if (victim != NO_PIECE || move.flag() == EN_PASSANT) {
+            // Most valuable victim first, least valuable attacker breaks ties
+            PieceType victimType = victim != NO_PIECE ? pieceType(victim) : PAWN;
+            PieceType attacker = pieceType(m_position.pieceOn(move.from()));
+            scores[i] = CaptureScore + PieceValue[victimType] * 8 - attacker;
+        } else if (move.isPromotion()) {
+            scores[i] = PromotionScore + PieceValue[move.promotion()];
+        } else if (move == m_killers[ply][0]) {
+            scores[i] = KillerScore + 1;
+        } else if (move == m_killers[ply][1]) {
+            scores[i] = KillerScore;
+        } else {
+            scores[i] = m_history[us][move.from()][move.to()];
+        }
+    }
+}
+
+void SearchWorker::checkLimits() {
+    if (m_id != 0) {
+        return;
+    }
+    const SearchLimits& limits = m_search.m_limits;
+    uint64_t nodes = m_nodes.load(std::memory_order_relaxed);
+    if (limits.nodes) {
+        // Summing every thread's count is only worth it once in a while
+        bool reached = m_search.threads() == 1 ? nodes >= limits.nodes
+                                               : (nodes & 1023) == 0 && m_search.nodes() >= limits.nodes;
+        if (reached) {
+            m_search.m_stop = true;
+        }
+    }
+    if ((nodes & 1023) == 0 && m_search.timeManaged() && m_search.clock() >= m_search.m_timeBudget) {
+        m_search.m_stop = true;
+    }
+}
+
+bool SearchWorker::stopped() const {
+    return m_search.m_stop.load(std::memory_order_relaxed);
+}
@@ -0,0 +1,162 @@
+// Alpha-beta search: iterative deepening with aspiration windows, a
+// transposition table, a quiescence search at the leaves and hash move /
+// MVV-LVA / killer / history move ordering, bounded by depth, nodes or
+// wall-clock time. Endgames covered by the tablebases (tablebase.h) are
+// scored from the tables, at the root they pick the move outright.
+//
+// Lazy SMP: every thread searches the same root on its own copy of the
+// position and its own ordering tables. They only share the transposition
+// table, which is how the helpers speed up the main thread.
+
+#ifndef SEARCH_H
+#define SEARCH_H
+
+#include "nnue.h"
+#include "position.h"
+#include "tt.h"
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <functional>
+#include <memory>
+#include <vector>
+
+const int MAX_PLY = 128;
+const int VALUE_INFINITE = 32001;
+const int VALUE_MATE = 32000;
+const int VALUE_MATE_IN_MAX_PLY = VALUE_MATE - MAX_PLY;
+
+struct SearchLimits {
+    int depth = MAX_PLY - 1;
+    uint64_t nodes = 0;      // 0 means unlimited
+    int moveTime = 0;        // Milliseconds for this move, 0 means unset
+    int time[2] = { 0, 0 };  // Remaining clock per color in milliseconds
+    int increment[2] = { 0, 0 };
+    int movesToGo = 0;
+    bool infinite = false;
+    bool ponder = false;     // No time control until ponderhit()
+};
+
+// Reported after every completed iteration.
+struct SearchInfo {
+    int depth;
+    int score;
+    uint64_t nodes;
+    int timeMs;
+    std::vector<Move> pv;
+};
+
+class Search;
+
+// State of one search thread. Worker 0 is the main thread: it owns the
+// clock and reports progress, helpers run until it stops them.
+class SearchWorker {
+    friend class Search;
+
+private:
+    Search& m_search;
+    int m_id;
+    Position m_position;
+    UndoStack m_undo;
+    std::vector<uint64_t> m_keys;  // Game history followed by the current search path
+    std::atomic<uint64_t> m_nodes;
+    std::atomic<uint64_t> m_ttProbes;  // Hash probes of this thread, summed by Search::hitRate()
+    std::atomic<uint64_t> m_ttHits;
+    int m_completedDepth;
+    int m_score;
+    Move m_bestMove;
+
+    Move m_killers[MAX_PLY][2];
+    int m_history[2][64][64];
+    Move m_pv[MAX_PLY][MAX_PLY];
+    int m_pvLength[MAX_PLY];
+
+    // NNUE accumulators by path length, brought up to date from the last
+    // computed one only when a position is evaluated
+    std::vector<Nnue::Accumulator> m_accumulators;
+    Nnue::Delta m_deltas[MAX_PLY];
+    bool m_accumulated[MAX_PLY];
+
+public:
+    SearchWorker(Search& search, int id);
+
+private:
+    void start(const Position& position, const std::vector<uint64_t>& history);
+    void iterate();
+
+    int negamax(int alpha, int beta, int depth, int ply);
+    int quiescence(int alpha, int beta, int ply);
+    int aspiration(int previous, int depth);
+
+    void makeMove(Move move);
+    void unmakeMove();
+    // The network's evaluation when one is loaded, evaluate() otherwise.
+    int staticEval();
+    bool isDraw() const;
+    bool isCapture(Move move) const;
+    void scoreMoves(const MoveList& moves, int scores[], Move hashMove, int ply) const;
+    void checkLimits();
+    bool stopped() const;
+    // Single writer, so a relaxed load and store is enough and avoids a locked add.
+    void countNode() { increment(m_nodes); }
+    static void increment(std::atomic<uint64_t>& counter) {
+        counter.store(counter.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    }
+};
+
+class Search {
+    friend class SearchWorker;
+
+public:
+    typedef std::function<void(const SearchInfo&)> InfoCallback;
+
+    static const int MaxThreads = 256;
+
+    explicit Search(TranspositionTable& tt, int threads = 1);
+    ~Search();
+
+    // Number of search threads including the calling one, clamped to [1, MaxThreads].
+    void setThreads(int threads);
+    int threads() const { return int(m_workers.size()); }
+
+    // Searches position and returns the best move, Move::none() if there is
+    // no legal move. history holds the keys of the earlier positions of the
+    // game so repetitions are scored as draws. The calling thread runs the
+    // main worker, helpers are started and joined inside.
+    Move think(const Position& position, const SearchLimits& limits,
+               const std::vector<uint64_t>& history = std::vector<uint64_t>(),
+               const InfoCallback& onInfo = InfoCallback());
+
+    // Safe to call from another thread, the search returns its best move so far.
+    void stop() { m_stop = true; }
+    // Turns a ponder search into a normal one, its clock starts now.
+    void ponderhit();
+    // Whether the search is in ponder mode, ponderhit() not called yet.
+    bool pondering() const { return m_pondering.load(std::memory_order_relaxed); }
+
+    // Nodes of all threads in the current or last search.
+    uint64_t nodes() const;
+    // Share of successful hash probes of all threads in the current or last search.
+    double hitRate() const;
+    int score() const { return m_score; }
+
+private:
+    TranspositionTable& m_tt;
+    std::vector<std::unique_ptr<SearchWorker>> m_workers;
+    SearchLimits m_limits;
+    InfoCallback m_onInfo;
+    std::chrono::steady_clock::time_point m_start;
+    int m_timeBudget;
+    std::atomic<int> m_clockStart;  // Milliseconds after m_start the time budget starts counting
+    std::atomic<bool> m_pondering;
+    std::atomic<bool> m_stop;
+    int m_score;
+
+    int elapsed() const;
+    // Whether the clock may end the search now.
+    bool timeManaged() const { return m_timeBudget && !m_limits.infinite && !m_pondering.load(std::memory_order_relaxed); }
+    // Milliseconds spent against the time budget.
+    int clock() const { return elapsed() - m_clockStart.load(std::memory_order_relaxed); }
+};
+
+#endif
@@ -0,0 +1,425 @@
+#include "server.h"
+#include "movegen.h"
+#include "profiler.h"
+#include <algorithm>
+#include <cerrno>
+#include <istream>
+#include <poll.h>
+#include <sstream>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+namespace {
+    const char* const ResultText[] = { "*", "1-0", "0-1", "1/2-1/2" };
+    const char* const KindName[] = { "new", "move", "go", "query" };
+
+    Move parseMove(const Position& position, const std::string& text) {
+        MoveList moves;
+        generateLegalMoves(position, moves);
+        for (Move move : moves) {
+            if (moveToString(move) == text) {
+                return move;
+            }
+        }
+        return Move::none();
+    }
+
+    bool parseId(std::istringstream& is, uint32_t& id) {
+        long long value = -1;
+        return (is >> value) && value > 0 && value <= 0xFFFFFFFFLL && (id = uint32_t(value), true);
+    }
+}
+
+LatencyHistogram::LatencyHistogram() {
+    for (std::atomic<uint64_t>& count : m_counts) {
+        count.store(0, std::memory_order_relaxed);
+    }
+}
+
+// Values below 8 get a bucket each, above that four buckets per power of two.
+void LatencyHistogram::record(uint64_t nanoseconds) {
+    int bucket = int(nanoseconds);
+    if (nanoseconds >= 8) {
+        int bit = 63 - __builtin_clzll(nanoseconds);
+        bucket = (bit - 1) * 4 + int((nanoseconds >> (bit - 2)) & 3);
+    }
+    m_counts[bucket].fetch_add(1, std::memory_order_relaxed);
+}
+
+uint64_t LatencyHistogram::count() const {
+    uint64_t total = 0;
+    for (const std::atomic<uint64_t>& count : m_counts) {
+        total += count.load(std::memory_order_relaxed);
+    }
+    return total;
+}
+
+uint64_t LatencyHistogram::percentile(double fraction) const {
+    uint64_t total = count();
+    uint64_t target = std::max<uint64_t>(1, uint64_t(fraction * total + 0.5));
+    uint64_t seen = 0;
+    for (int bucket = 0; bucket < Buckets; ++bucket) {
+        seen += m_counts[bucket].load(std::memory_order_relaxed);
+        if (seen >= target) {
+            if (bucket < 8) {
+                return uint64_t(bucket);
+            }
+            int bit = bucket / 4 + 1;
+            return (uint64_t(5 + bucket % 4) << (bit - 2)) - 1;
+        }
+    }
+    return 0;
+}
+
+GameServer::Connection::~Connection() {
+    if (socket) {
+        ::close(fd);
+    }
+}
+
+void GameServer::Connection::send(const std::string& line) {
+    std::lock_guard<std::mutex> lock(mutex);
+    std::string text = line + '\n';
+    const char* data = text.data();
+    size_t size = text.size();
+    while (size > 0) {
+        ssize_t written = socket ? ::send(fd, data, size, MSG_NOSIGNAL) : ::write(fd, data, size);
+        if (written < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;  // The client is gone, its replies are dropped
+        }
+        data += written;
+        size -= size_t(written);
+    }
+}
+
+GameServer::ServerGame::ServerGame(uint32_t id, const Position& start)
+    : id(id), position(start), result(ONGOING), bytes(0), scheduled(false) {
+    bytes = memory();
+}
+
+// Everything the game owns, queued commands included. The vectors are
+// counted by capacity, that is what they hold on to.
+size_t GameServer::ServerGame::memory() const {
+    return sizeof(ServerGame) + keys.capacity() * sizeof(uint64_t) + moves.capacity() * sizeof(Move)
+         + pending.capacity() * sizeof(Command);
+}
+
+GameServer::GameServer(int workers, int hashMB) : m_pool(workers), m_nextId(1) {
+    for (int i = 0; i < m_pool.size(); ++i) {
+        m_idleEngines.emplace_back(new Engine(hashMB));
+    }
+}
+
+GameServer::~GameServer() {
+    m_pool.wait();
+}
+
+void GameServer::serveStream(std::istream& in) {
+    std::shared_ptr<Connection> connection = std::make_shared<Connection>(STDOUT_FILENO, false);
+    std::string line;
+    while (std::getline(in, line)) {
+        if (!dispatch(connection, line, Profiler::now())) {
+            break;
+        }
+    }
+    m_pool.wait();
+}
+
+// One thread polls the listener and every client. Lines are dispatched as
+// they complete, a client that sends quit or hangs up is dropped; its
+// connection lives on until the replies still queued for it are written.
+bool GameServer::serveSocket(const std::string& path) {
+    sockaddr_un address = {};
+    address.sun_family = AF_UNIX;
+    if (path.size() >= sizeof(address.sun_path)) {
+        return false;
+    }
+    std::copy(path.begin(), path.end(), address.sun_path);
+    int listener = ::socket(AF_UNIX, SOCK_STREAM, 0);
+    if (listener < 0) {
+        return false;
+    }
+    ::unlink(path.c_str());
+    if (::bind(listener, reinterpret_cast<sockaddr*>(&address), sizeof(address)) != 0 || ::listen(listener, 64) != 0) {
+        ::close(listener);
+        return false;
+    }
+
+    struct Client {
+        std::shared_ptr<Connection> connection;
+        std::string buffer;  // Bytes after the last complete line
+    };
+    std::vector<pollfd> fds = { { listener, POLLIN, 0 } };
+    std::vector<Client> clients;
+    char chunk[64 << 10];
+    for (;;) {
+        if (::poll(fds.data(), fds.size(), -1) < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            break;
+        }
+        for (size_t i = fds.size(); i-- > 1;) {
+            if (!fds[i].revents) {
+                continue;
+            }
+            Client& client = clients[i - 1];
+            ssize_t received = ::read(fds[i].fd, chunk, sizeof(chunk));
+            bool open = received > 0;
+            uint64_t now = Profiler::now();
+            if (open) {
+                client.buffer.append(chunk, size_t(received));
+                size_t begin = 0, end;
+                while (open && (end = client.buffer.find('\n', begin)) != std::string::npos) {
+                    open = dispatch(client.connection, client.buffer.substr(begin, end - begin), now);
+                    begin = end + 1;
+                }
+                client.buffer.erase(0, begin);
+            } else if (received < 0 && errno == EINTR) {
+                continue;
+            }
+            if (!open) {
+                ::shutdown(fds[i].fd, SHUT_RD);
+                fds.erase(fds.begin() + i);
+                clients.erase(clients.begin() + (i - 1));
+            }
+        }
+        if (fds[0].revents & POLLIN) {
+            int fd = ::accept(listener, nullptr, nullptr);
+            if (fd >= 0) {
+                fds.push_back({ fd, POLLIN, 0 });
+                clients.push_back({ std::make_shared<Connection>(fd, true), std::string() });
+            }
+        }
+    }
+    ::close(listener);
+    return true;
+}
+
+bool GameServer::dispatch(const std::shared_ptr<Connection>& connection, const std::string& line, uint64_t received) {
+    std::istringstream is(line);
+    std::string verb;
+    if (!(is >> verb)) {
+        return true;
+    }
+    if (verb == "quit") {
+        return false;
+    }
+    if (verb == "stats") {
+        connection->send(stats());
+        return true;
+    }
+    if (verb == "new") {
+        Position start;
+        std::string token, fen;
+        if (is >> token) {
+            std::getline(is, fen);
+            // Strict, a position the rules cannot play would bring down every game
+            fen = fen.substr(std::min(fen.size(), fen.find_first_not_of(' ')));
+            if (token != "fen" || !start.setFromFen(fen, true)) {
+                connection->send("error bad fen");
+                return true;
+            }
+        } else {
+            start.setStartPosition();
+        }
+        uint32_t id;
+        {
+            std::lock_guard<std::mutex> lock(m_gamesMutex);
+            id = m_nextId++;
+            m_games.emplace(id, std::make_shared<ServerGame>(id, start));
+        }
+        connection->send("new " + std::to_string(id));
+        m_latency[NEW].record(Profiler::now() - received);
+        return true;
+    }
+
+    Command command;
+    command.connection = connection;
+    command.received = received;
+    command.move[0] = 0;
+    command.kind = QUERY;
+    command.verb = verb[0];
+    uint32_t id = 0;
+    if (verb != "move" && verb != "go" && verb != "fen" && verb != "info" && verb != "close") {
+        connection->send("error unknown command " + verb);
+        return true;
+    }
+    if (!parseId(is, id)) {
+        connection->send("error " + verb + " needs a game id");
+        return true;
+    }
+    if (verb == "move") {
+        std::string move;
+        if (!(is >> move) || move.size() > 5) {
+            connection->send("error move " + std::to_string(id) + " needs a move");
+            return true;
+        }
+        command.kind = MOVE;
+        std::copy(move.begin(), move.end(), command.move);
+        command.move[move.size()] = 0;
+    } else if (verb == "go") {
+        command.kind = GO;
+        std::string token;
+        int value;
+        command.limits.moveTime = 100;
+        while (is >> token >> value) {
+            if (token == "movetime") {
+                command.limits.moveTime = std::max(1, value);
+            } else if (token == "nodes") {
+                command.limits.nodes = uint64_t(std::max(1, value));
+                command.limits.moveTime = 0;
+            } else if (token == "depth") {
+                command.limits.depth = std::min(std::max(1, value), MAX_PLY - 1);
+                command.limits.moveTime = 0;
+            }
+        }
+    }
+
+    std::shared_ptr<ServerGame> game;
+    {
+        std::lock_guard<std::mutex> lock(m_gamesMutex);
+        auto it = m_games.find(id);
+        if (it != m_games.end()) {
+            game = it->second;
+            if (verb == "close") {
+                m_games.erase(it);  // Commands already queued still run
+            }
+        }
+    }
+    if (!game) {
+        connection->send("error no game " + std::to_string(id));
+        return true;
+    }
+    queue(game, std::move(command));
+    return true;
+}
+
+// The first command of an idle game schedules it on the pool, later ones
+// join the queue the scheduled worker is draining.
+void GameServer::queue(const std::shared_ptr<ServerGame>& game, Command command) {
+    {
+        std::lock_guard<std::mutex> lock(game->mutex);
+        game->pending.push_back(std::move(command));
+        if (game->scheduled) {
+            return;
+        }
+        game->scheduled = true;
+    }
+    m_pool.submit([this, game] { drain(game); });
+}
+
+void GameServer::drain(const std::shared_ptr<ServerGame>& game) {
+    Command command;
+    for (;;) {
+        {
+            std::lock_guard<std::mutex> lock(game->mutex);
+            if (game->pending.empty()) {
+                game->scheduled = false;
+                game->bytes.store(game->memory(), std::memory_order_relaxed);
+                return;
+            }
+            command = std::move(game->pending.front());
+            game->pending.erase(game->pending.begin());
+        }
+        run(*game, command);
+    }
+}
+
+void GameServer::run(ServerGame& game, const Command& command) {
+    std::string id = std::to_string(game.id);
+    switch (command.verb) {
+    case 'm': {
+        Move move = game.result == ONGOING ? parseMove(game.position, command.move) : Move::none();
+        if (move == Move::none()) {
+            reply(command, "move " + id + " illegal");
+        } else {
+            play(game, move);
+            reply(command, "move " + id + " ok " + ResultText[game.result]);
+        }
+        break;
+    }
+    case 'g': {
+        Move move = game.result == ONGOING ? engineMove(game, command.limits) : Move::none();
+        if (move != Move::none()) {
+            play(game, move);
+        }
+        reply(command, "go " + id + " " + (move == Move::none() ? std::string("none") : moveToString(move)) + " " + ResultText[game.result]);
+        break;
+    }
+    case 'f':
+        reply(command, "fen " + id + " " + game.position.toFen());
+        break;
+    case 'i':
+        reply(command, "info " + id + " plies " + std::to_string(game.moves.size()) + " bytes "
+                       + std::to_string(game.memory()) + " result " + ResultText[game.result]);
+        break;
+    case 'c':
+        reply(command, "close " + id + " ok");
+        break;
+    }
+}
+
+// Plays a legal move and decides whether it ended the game: mate,
+// stalemate, threefold repetition or the fifty-move rule.
+bool GameServer::play(ServerGame& game, Move move) {
+    UndoRecord undo;
+    game.keys.push_back(game.position.key());
+    game.position.makeMove(move, undo);
+    game.moves.push_back(move);
+    if (game.position.halfmoveClock() == 0) {
+        game.keys.clear();  // Nothing before an irreversible move can repeat
+    }
+    if (!hasLegalMove(game.position)) {
+        game.result = !game.position.checkers() ? DRAW : game.position.sideToMove() == WHITE ? BLACK_WINS : WHITE_WINS;
+    } else if (game.position.halfmoveClock() >= 100
+               || std::count(game.keys.begin(), game.keys.end(), game.position.key()) >= 2) {
+        game.result = DRAW;
+    }
+    return game.result != ONGOING;
+}
+
+// At most one command per worker runs at a time, so an engine is always idle.
+Move GameServer::engineMove(ServerGame& game, const SearchLimits& limits) {
+    std::unique_ptr<Engine> engine;
+    {
+        std::lock_guard<std::mutex> lock(m_enginesMutex);
+        engine = std::move(m_idleEngines.back());
+        m_idleEngines.pop_back();
+    }
+    Move move = engine->search.think(game.position, limits, game.keys);
+    std::lock_guard<std::mutex> lock(m_enginesMutex);
+    m_idleEngines.push_back(std::move(engine));
+    return move;
+}
+
+void GameServer::reply(const Command& command, const std::string& line) {
+    command.connection->send(line);
+    m_latency[command.kind].record(Profiler::now() - command.received);
+}
+
+std::string GameServer::stats() {
+    size_t games = 0, total = 0, largest = 0;
+    {
+        std::lock_guard<std::mutex> lock(m_gamesMutex);
+        for (const auto& entry : m_games) {
+            size_t bytes = entry.second->bytes.load(std::memory_order_relaxed);
+            ++games;
+            total += bytes;
+            largest = std::max(largest, bytes);
+        }
+    }
+    std::ostringstream os;
+    os << "stats games " << games << " bytes " << total << " perGame " << (games ? total / games : 0)
+       << " largest " << largest << " workers " << m_pool.size();
+    for (int kind = 0; kind < COMMAND_KINDS; ++kind) {
+        const LatencyHistogram& latency = m_latency[kind];
+        os << " " << KindName[kind] << " count " << latency.count()
+           << " p50us " << latency.percentile(0.50) / 1000 << " p99us " << latency.percentile(0.99) / 1000;
+    }
+    return os.str();
+}
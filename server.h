@@ -0,0 +1,150 @@
+// Headless host for many independent games, driven by a line protocol on
+// stdin or a Unix socket. A game is only a position and its history, no
+// window or search of its own, so thousands fit in a few megabytes.
+//
+// The reading thread parses commands and queues them on their game; a
+// fixed worker pool runs each game's queue in order, so commands of one
+// game never overlap while different games run in parallel. Engine moves
+// use one search and hash table per worker.
+//
+//   new [fen <fen>]                     -> new <id> | error bad fen
+//   move <id> <uci>                     -> move <id> ok <result> | move <id> illegal
+//   go <id> [movetime ms | nodes n | depth d]
+//                                       -> go <id> <uci> <result>   (the move is played)
+//   fen <id>                            -> fen <id> <fen>
+//   info <id>                           -> info <id> plies <n> bytes <n> result <result>
+//   close <id>                          -> close <id> ok
+//   stats                               -> games, memory and latency percentiles
+//   quit                                   ends a stdin session, closes a socket connection
+//
+// result is "*" while the game goes on, then "1-0", "0-1" or "1/2-1/2".
+// Errors answer "error <message>". Replies to different games can arrive
+// out of order, every reply names its game.
+
+#ifndef SERVER_H
+#define SERVER_H
+
+#include "search.h"
+#include "thread_pool.h"
+#include <atomic>
+#include <cstdint>
+#include <iosfwd>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <vector>
+
+// Counts of durations in buckets a quarter of a power of two wide, so the
+// percentiles are within 25% and recording is a single relaxed add.
+class LatencyHistogram {
+public:
+    static const int Buckets = 256;
+
+private:
+    std::atomic<uint64_t> m_counts[Buckets];
+
+public:
+    LatencyHistogram();
+
+    void record(uint64_t nanoseconds);
+    uint64_t count() const;
+    // Upper edge of the bucket holding the given fraction of the samples.
+    uint64_t percentile(double fraction) const;
+};
+
+class GameServer {
+public:
+    // One client, replies are written whole under the mutex.
+    struct Connection {
+        int fd;
+        bool socket;  // Written with send() so a closed peer cannot raise SIGPIPE
+        std::mutex mutex;
+
+        Connection(int fd, bool socket) : fd(fd), socket(socket) {}
+        ~Connection();
+        void send(const std::string& line);
+    };
+
+    enum CommandKind {
+        NEW,
+        MOVE,
+        GO,
+        QUERY,  // fen, info and close
+        COMMAND_KINDS
+    };
+
+private:
+    enum Result : uint8_t { ONGOING, WHITE_WINS, BLACK_WINS, DRAW };
+
+    struct Command {
+        CommandKind kind;
+        char verb;       // 'm'ove, 'g'o, 'f'en, 'i'nfo or 'c'lose
+        char move[6];    // UCI text of a move command
+        SearchLimits limits;
+        std::shared_ptr<Connection> connection;
+        uint64_t received;  // Profiler::now() when the line was read
+    };
+
+    struct ServerGame {
+        uint32_t id;
+        Position position;
+        std::vector<uint64_t> keys;  // Positions before position since the last irreversible move
+        std::vector<Move> moves;     // The whole game
+        Result result;
+        std::atomic<size_t> bytes;   // Memory of the game, updated after every command
+
+        std::mutex mutex;               // Guards pending and scheduled
+        std::vector<Command> pending;   // Waiting for a worker, oldest first
+        bool scheduled;                 // A worker owns the queue
+
+        ServerGame(uint32_t id, const Position& start);
+        size_t memory() const;
+    };
+
+    // Search state of one worker, handed out to whoever runs an engine move
+    struct Engine {
+        TranspositionTable tt;
+        Search search;
+
+        explicit Engine(int hashMB) : tt(hashMB), search(tt) {}
+    };
+
+    WorkStealingPool m_pool;
+    std::mutex m_gamesMutex;
+    std::unordered_map<uint32_t, std::shared_ptr<ServerGame>> m_games;
+    uint32_t m_nextId;  // Reading thread only
+    std::mutex m_enginesMutex;
+    std::vector<std::unique_ptr<Engine>> m_idleEngines;
+    LatencyHistogram m_latency[COMMAND_KINDS];
+
+public:
+    // workers <= 0 uses one per core, each with a hashMB table for engine moves.
+    GameServer(int workers, int hashMB);
+    ~GameServer();
+    GameServer(const GameServer&) = delete;
+    GameServer& operator=(const GameServer&) = delete;
+
+    // Serves one session on stdin and stdout until quit or the end of input.
+    void serveStream(std::istream& in);
+    // Serves any number of clients on a Unix socket at path, until the
+    // process is stopped. False if the socket cannot be created.
+    bool serveSocket(const std::string& path);
+
+    // Handles one line of a connection, received is Profiler::now() when it
+    // was read. False for quit.
+    bool dispatch(const std::shared_ptr<Connection>& connection, const std::string& line, uint64_t received);
+    // Blocks until every queued command has been answered.
+    void wait() { m_pool.wait(); }
+    std::string stats();
+
+private:
+    void queue(const std::shared_ptr<ServerGame>& game, Command command);
+    void drain(const std::shared_ptr<ServerGame>& game);
+    void run(ServerGame& game, const Command& command);
+    bool play(ServerGame& game, Move move);
+    Move engineMove(ServerGame& game, const SearchLimits& limits);
+    void reply(const Command& command, const std::string& line);
+};
+
+#endif
@@ -0,0 +1,53 @@
+// Bounded lock-free queue between exactly one producer and one consumer
+// thread. Each side only writes its own index, so pushing and popping are
+// a load and a release store with no locks or read-modify-write atomics.
+
+#ifndef SPSC_QUEUE_H
+#define SPSC_QUEUE_H
+
+#include <atomic>
+#include <cstddef>
+#include <utility>
+
+template <typename T, size_t Capacity>
+class SpscQueue {
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity must be a power of two");
+
+private:
+    T m_slots[Capacity];
+    // Apart so the two threads do not share a cache line
+    alignas(64) std::atomic<size_t> m_head;  // Next slot to pop, written by the consumer
+    alignas(64) std::atomic<size_t> m_tail;  // Next slot to push, written by the producer
+
+public:
+    SpscQueue() : m_head(0), m_tail(0) {}
+    SpscQueue(const SpscQueue&) = delete;
+    SpscQueue& operator=(const SpscQueue&) = delete;
+
+    // Producer only. False if the queue is full.
+    bool push(T value) {
+        size_t tail = m_tail.load(std::memory_order_relaxed);
+        if (tail - m_head.load(std::memory_order_acquire) == Capacity) {
+            return false;
+        }
+        m_slots[tail % Capacity] = std::move(value);
+        m_tail.store(tail + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Consumer only. False if the queue is empty.
+    bool pop(T& value) {
+        size_t head = m_head.load(std::memory_order_relaxed);
+        if (head == m_tail.load(std::memory_order_acquire)) {
+            return false;
+        }
+        value = std::move(m_slots[head % Capacity]);
+        m_head.store(head + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Exact for the consumer, a hint for anyone else.
+    bool empty() const { return m_head.load(std::memory_order_acquire) == m_tail.load(std::memory_order_acquire); }
+};
+
+#endif
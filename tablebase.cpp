@@ -0,0 +1,354 @@
+#include "tablebase.h"
+#include "evaluate.h"
+#include "mapped_file.h"
+#include "movegen.h"
+#include <algorithm>
+#include <climits>
+#include <cstring>
+#include <filesystem>
+#include <memory>
+#include <unordered_map>
+#include <vector>
+
+namespace {
+    const char* PieceLetters = "PNBRQK";
+
+    // Letters of one side, king first and the rest strongest first.
+    std::string sideName(const int pieces[], int count, Color c) {
+        std::string name = "K";
+        for (int pt = QUEEN; pt >= PAWN; --pt) {
+            for (int i = 0; i < count; ++i) {
+                if (pieces[i] == makePiece(c, PieceType(pt))) {
+                    name += PieceLetters[pt];
+                }
+            }
+        }
+        return name;
+    }
+
+    int sideValue(const std::string& side) {
+        int value = 0;
+        for (char c : side) {
+            value += PieceValue[std::strchr(PieceLetters, c) - PieceLetters];
+        }
+        return value;
+    }
+
+    bool stronger(const std::string& a, const std::string& b) {
+        if (a.size() != b.size()) {
+            return a.size() > b.size();
+        }
+        int va = sideValue(a), vb = sideValue(b);
+        return va != vb ? va > vb : a >= b;
+    }
+
+    // Non-king piece counts, four bits per piece, white pieces in the low half.
+    uint64_t materialKey(const int counts[12], bool flip) {
+        uint64_t key = 0;
+        for (int piece = 0; piece < 12; ++piece) {
+            if (pieceType(piece) != KING) {
+                int from = flip ? makePiece(~pieceColor(piece), pieceType(piece)) : piece;
+                key |= uint64_t(counts[from]) << (4 * piece);
+            }
+        }
+        return key;
+    }
+
+    uint64_t materialKey(const Position& position, bool flip) {
+        int counts[12];
+        for (int piece = 0; piece < 12; ++piece) {
+            counts[piece] = popCount(position.pieces(pieceColor(piece), pieceType(piece)));
+        }
+        return materialKey(counts, flip);
+    }
+
+    // Square of the white king after mirroring, the first index digit.
+    int kingIndex(int sq) { return squareFile(sq) + 4 * squareRank(sq); }
+
+    class Table {
+    private:
+        MappedFile m_file;
+        TbLayout m_layout;
+        const unsigned char* m_offsets;
+        const unsigned char* m_blocks;
+
+    public:
+        Table() : m_offsets(nullptr), m_blocks(nullptr) {}
+
+        bool open(const std::string& path, const TbLayout& layout) {
+            if (!m_file.open(path, MappedFile::RANDOM) || m_file.size() < sizeof(TbHeader)) {
+                return false;
+            }
+            TbHeader header;
+            std::memcpy(&header, m_file.data(), sizeof(header));
+            uint64_t blocks = (layout.size() + TbBlockSize - 1) / TbBlockSize;
+            if (std::memcmp(header.magic, TbMagic, sizeof(TbMagic)) != 0 || header.entries != layout.size() ||
+                header.blocks != blocks || m_file.size() < sizeof(header) + (blocks + 1) * 8 + 8) {
+                return false;
+            }
+            m_layout = layout;
+            m_offsets = reinterpret_cast<const unsigned char*>(m_file.data()) + sizeof(header);
+            m_blocks = m_offsets + (blocks + 1) * 8;
+            return offset(blocks) + 8 <= m_file.size() - (m_blocks - reinterpret_cast<const unsigned char*>(m_file.data()));
+        }
+
+        const TbLayout& layout() const { return m_layout; }
+
+        int entry(uint64_t index) const {
+            const unsigned char* block = m_blocks + offset(index / TbBlockSize);
+            uint16_t base;
+            std::memcpy(&base, block, 2);
+            int width = block[2];
+            if (width == 0) {
+                return base;
+            }
+            uint64_t bit = index % TbBlockSize * width;
+            uint64_t word;
+            std::memcpy(&word, block + 3 + bit / 8, 8);
+            return base + int(word >> (bit % 8) & ((1u << width) - 1));
+        }
+
+    private:
+        uint64_t offset(uint64_t block) const {
+            uint64_t value;
+            std::memcpy(&value, m_offsets + block * 8, 8);
+            return value;
+        }
+    };
+
+    std::vector<std::unique_ptr<Table>> tables;
+    std::unordered_map<uint64_t, const Table*> tablesByMaterial;
+    int largestTable = 0;
+
+    const Table* findTable(const Position& position, bool& flip) {
+        flip = false;
+        auto it = tablesByMaterial.find(materialKey(position, false));
+        if (it == tablesByMaterial.end()) {
+            flip = true;
+            it = tablesByMaterial.find(materialKey(position, true));
+        }
+        return it == tablesByMaterial.end() ? nullptr : it->second;
+    }
+
+    bool probeChild(const Position& position, Move move, TbResult& result) {
+        Position child = position;
+        UndoRecord undo;
+        child.makeMove(move, undo);
+        result = { WDL_DRAW, 0 };
+        return popCount(child.occupied()) == 2 || Tablebases::probe(child, result);
+    }
+
+    // The tables hold positions without en passant rights: take the better of
+    // the entry without the right and the en passant captures.
+    bool probeEnPassant(const Position& position, TbResult& result) {
+        MoveList moves;
+        generateLegalMoves(position, moves);
+        bool others = false, captures = false;
+        for (Move move : moves) {
+            TbResult r;
+            if (move.flag() != EN_PASSANT) {
+                others = true;
+            } else if (!probeChild(position, move, r)) {
+                return false;
+            } else if (!captures || Tablebases::better(Tablebases::afterMove(r), result)) {
+                captures = true;
+                result = Tablebases::afterMove(r);
+            }
+        }
+        if (others) {
+            int pieces[TbLayout::MaxPieces], squares[TbLayout::MaxPieces];
+            int count = 0;
+            for (Bitboard b = position.occupied(); b;) {
+                squares[count] = popLsb(b);
+                pieces[count] = position.pieceOn(squares[count]);
+                ++count;
+            }
+            Position plain;
+            TbResult r;
+            if (!plain.setFromPieces(pieces, squares, count, position.sideToMove()) || !Tablebases::probe(plain, r)) {
+                return false;
+            }
+            if (!captures || Tablebases::better(r, result)) {
+                result = r;
+            }
+        }
+        return true;
+    }
+}
+
+const int TbLayout::MaxPieces;
+
+bool TbLayout::parse(const std::string& name) {
+    size_t v = name.find('v');
+    if (v == std::string::npos || name.size() - 1 > size_t(MaxPieces)) {
+        return false;
+    }
+    int pieces[MaxPieces];
+    int count = 0, kings = 0;
+    for (size_t i = 0; i < name.size(); ++i) {
+        if (i == v) {
+            continue;
+        }
+        const char* letter = name[i] ? std::strchr(PieceLetters, name[i]) : nullptr;
+        if (!letter) {
+            return false;
+        }
+        PieceType pt = PieceType(letter - PieceLetters);
+        pieces[count++] = makePiece(i < v ? WHITE : BLACK, pt);
+        kings += pt == KING ? (i < v ? 1 : 16) : 0;
+    }
+    if (count < 3 || kings != 17) {
+        return false;  // Not one king per side
+    }
+
+    // Stronger side as white, then kings and the others in name order
+    std::string sides[2] = { sideName(pieces, count, WHITE), sideName(pieces, count, BLACK) };
+    if (!stronger(sides[WHITE], sides[BLACK])) {
+        std::swap(sides[WHITE], sides[BLACK]);
+    }
+    m_pieces[0] = makePiece(WHITE, KING);
+    m_pieces[1] = makePiece(BLACK, KING);
+    m_count = 2;
+    m_hasPawns = false;
+    for (Color c : { WHITE, BLACK }) {
+        for (size_t i = 1; i < sides[c].size(); ++i) {
+            PieceType pt = PieceType(std::strchr(PieceLetters, sides[c][i]) - PieceLetters);
+            m_pieces[m_count++] = makePiece(c, pt);
+            m_hasPawns |= pt == PAWN;
+        }
+    }
+    return true;
+}
+
+std::string TbLayout::name() const {
+    return sideName(m_pieces, m_count, WHITE) + "v" + sideName(m_pieces, m_count, BLACK);
+}
+
+uint64_t TbLayout::size() const {
+    uint64_t size = 2 * (m_hasPawns ? 32 : 16) * 64;
+    for (int i = 2; i < m_count; ++i) {
+        size *= 64;
+    }
+    return size;
+}
+
+uint64_t TbLayout::index(const Position& position, bool flip) const {
+    int flipSquare = flip ? 56 : 0;
+    int wk = position.kingSquare(flip ? BLACK : WHITE) ^ flipSquare;
+    int mirror = (squareFile(wk) > 3 ? 7 : 0) ^ (!m_hasPawns && squareRank(wk) > 3 ? 56 : 0);
+    int bk = position.kingSquare(flip ? WHITE : BLACK) ^ flipSquare ^ mirror;
+    Color stm = flip ? ~position.sideToMove() : position.sideToMove();
+
+    uint64_t index = (uint64_t(stm) * (m_hasPawns ? 32 : 16) + kingIndex(wk ^ mirror)) * 64 + bk;
+    for (int i = 2; i < m_count;) {
+        // A run of identical pieces goes in ascending order of the mirrored squares
+        int piece = m_pieces[i];
+        Color c = flip ? ~pieceColor(piece) : pieceColor(piece);
+        Bitboard b = position.pieces(c, pieceType(piece));
+        int squares[MaxPieces];
+        int n = 0;
+        while (b) {
+            squares[n++] = popLsb(b) ^ flipSquare ^ mirror;
+        }
+        std::sort(squares, squares + n);
+        for (int j = 0; j < n; ++j) {
+            index = index * 64 + squares[j];
+        }
+        i += n;
+    }
+    return index;
+}
+
+bool TbLayout::decode(uint64_t index, Position& position) const {
+    int squares[MaxPieces];
+    for (int i = m_count - 1; i >= 1; --i) {
+        squares[i] = int(index % 64);
+        index /= 64;
+    }
+    int kings = m_hasPawns ? 32 : 16;
+    squares[0] = int(index % kings % 4 + index % kings / 4 * 8);
+    Color stm = Color(index / kings);
+    for (int i = 3; i < m_count; ++i) {
+        if (m_pieces[i] == m_pieces[i - 1] && squares[i] <= squares[i - 1]) {
+            return false;
+        }
+    }
+    return position.setFromPieces(m_pieces, squares, m_count, stm);
+}
+
+namespace Tablebases {
+    int init(const std::string& directory) {
+        release();
+        std::error_code error;
+        for (const auto& file : std::filesystem::directory_iterator(directory, error)) {
+            TbLayout layout;
+            std::string stem = file.path().stem().string();
+            if (file.path().extension() != ".ctb" || !layout.parse(stem) || layout.name() != stem) {
+                continue;
+            }
+            std::unique_ptr<Table> table(new Table);
+            if (!table->open(file.path().string(), layout)) {
+                continue;
+            }
+            int counts[12] = {};
+            for (int i = 0; i < layout.count(); ++i) {
+                ++counts[layout.piece(i)];
+            }
+            tablesByMaterial[materialKey(counts, false)] = table.get();
+            largestTable = std::max(largestTable, layout.count());
+            tables.push_back(std::move(table));
+        }
+        return int(tables.size());
+    }
+
+    void release() {
+        tablesByMaterial.clear();
+        tables.clear();
+        largestTable = 0;
+    }
+
+    int maxPieces() { return largestTable; }
+
+    bool better(const TbResult& a, const TbResult& b) {
+        auto rank = [](const TbResult& r) {
+            return r.wdl == WDL_WIN ? INT_MAX - r.dtm : r.wdl == WDL_LOSS ? INT_MIN + 1 + r.dtm : 0;
+        };
+        return rank(a) > rank(b);
+    }
+
+    bool probe(const Position& position, TbResult& result) {
+        if (popCount(position.occupied()) > largestTable || position.castlingRights()) {
+            return false;
+        }
+        if (position.epSquare() != NO_SQUARE) {
+            return probeEnPassant(position, result);
+        }
+        bool flip;
+        const Table* table = findTable(position, flip);
+        if (!table) {
+            return false;
+        }
+        result = decode(table->entry(table->layout().index(position, flip)));
+        return true;
+    }
+
+    Move bestMove(const Position& position, TbResult& result) {
+        if (popCount(position.occupied()) > largestTable) {
+            return Move::none();
+        }
+        MoveList moves;
+        generateLegalMoves(position, moves);
+        Move best = Move::none();
+        for (Move move : moves) {
+            TbResult r;
+            if (!probeChild(position, move, r)) {
+                return Move::none();
+            }
+            if (best == Move::none() || better(afterMove(r), result)) {
+                best = move;
+                result = afterMove(r);
+            }
+        }
+        return best;
+    }
+}
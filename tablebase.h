@@ -0,0 +1,115 @@
+// Endgame tablebases: win, draw or loss and the distance to mate of every
+// position of a material set with up to five pieces, made by retrograde
+// analysis in the TbGen tool. Positions with castling rights are not
+// covered. The tables hold no en passant rights: a probe adds the captures
+// itself, but inside a table a double step is scored as if the opponent
+// could not take it en passant.
+//
+// A table file (<name>.ctb, e.g. KQvKR.ctb) stores one entry per index of
+// its TbLayout: 0 for a draw, otherwise the distance to mate in plies plus
+// one, so an odd distance is a win for the side to move and an even one a
+// loss. Entries are cut into blocks with their own base value and bit
+// width. The files are memory-mapped and a probe unpacks the one entry it
+// needs from its block, touching a page or two.
+
+#ifndef TABLEBASE_H
+#define TABLEBASE_H
+
+#include "position.h"
+#include <cstdint>
+#include <string>
+
+enum Wdl {
+    WDL_LOSS = -1,
+    WDL_DRAW = 0,
+    WDL_WIN = 1
+};
+
+struct TbResult {
+    Wdl wdl;
+    int dtm;  // Plies to mate with best play, 0 for a draw
+};
+
+// Index space of a material set. Slots 0 and 1 are the white and black
+// king, the other pieces follow in name order. The board is mirrored so
+// the white king stands on files a-d and, without pawns, on ranks 1-4 too.
+// Identical pieces are stored in ascending square order, every other
+// ordering is an unused index.
+class TbLayout {
+public:
+    static const int MaxPieces = 5;
+
+private:
+    int m_pieces[MaxPieces];
+    int m_count;
+    bool m_hasPawns;
+
+public:
+    TbLayout() : m_count(0), m_hasPawns(false) {}
+
+    // Reads a name like "KRPvKR", white side first. Each side needs exactly
+    // one king. The name is put into canonical order, see name().
+    bool parse(const std::string& name);
+    // Stronger side first: more pieces, then more material.
+    std::string name() const;
+    int count() const { return m_count; }
+    int piece(int slot) const { return m_pieces[slot]; }
+    uint64_t size() const;
+
+    // Index of position, which must hold this material, with the colors
+    // swapped and the board flipped when flip is set.
+    uint64_t index(const Position& position, bool flip = false) const;
+    // False if index is unused or its position is illegal.
+    bool decode(uint64_t index, Position& position) const;
+};
+
+// Canonical table name of the pieces on the board, sets flip when black is
+// the stronger side and the position must be flipped to index it.
+std::string tablebaseName(const Position& position, bool& flip);
+
+namespace Tablebases {
+    // Maps every table file in directory, replacing any tables already
+    // loaded, and returns how many were found. Not safe during a search.
+    int init(const std::string& directory);
+    void release();
+
+    // Most pieces of a loaded table, 0 when there are none.
+    int maxPieces();
+
+    // False if no loaded table covers the position.
+    bool probe(const Position& position, TbResult& result);
+    // Move that mates fastest, keeps the draw or delays mate longest, and
+    // the result of the position. Move::none() if any move leaves the
+    // tables or there is no legal move. Lone kings are a draw.
+    Move bestMove(const Position& position, TbResult& result);
+
+    // Result of the side to move when its move leads to result.
+    inline TbResult afterMove(const TbResult& result) {
+        return result.wdl == WDL_DRAW ? result : TbResult{ Wdl(-result.wdl), result.dtm + 1 };
+    }
+    // Whether a is better than b for the side to move: a shorter win, a draw
+    // rather than a loss, a longer loss.
+    bool better(const TbResult& a, const TbResult& b);
+
+    // Entry codes of the table files.
+    inline int encode(const TbResult& result) { return result.wdl == WDL_DRAW ? 0 : result.dtm + 1; }
+    inline TbResult decode(int code) {
+        return code == 0 ? TbResult{ WDL_DRAW, 0 } : TbResult{ (code - 1) % 2 ? WDL_WIN : WDL_LOSS, code - 1 };
+    }
+}
+
+// File layout, all fields little-endian.
+const char TbMagic[8] = { 'C', 'W', 'O', 'T', 'B', '1', 0, 0 };
+const int TbBlockSize = 4096;  // Entries per block
+
+struct TbHeader {
+    char magic[8];
+    char name[16];
+    uint64_t entries;
+    uint64_t blocks;
+    // Followed by blocks + 1 uint64_t block offsets from the end of the
+    // offset table, then the blocks: uint16_t base, uint8_t bit width and
+    // the entries minus base packed LSB first, then 8 bytes of padding.
+};
+
+#endif
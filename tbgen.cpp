@@ -0,0 +1,535 @@
+// Generates endgame tablebases (tablebase.h) by retrograde analysis.
+//
+//   tbgen [--threads n] [--force] <directory> <material>...   e.g. tbgen tb KQvK KRvK KQvKR
+//
+// Tables a requested one reaches by a capture or a promotion are made
+// first unless directory already has them, --force remakes the requested
+// ones. Every pass runs on the work-stealing pool over slices of the index.
+//
+// The first pass decodes every index, marks mates and stalemates, looks up
+// the moves that leave the table in the smaller tables and counts the
+// moves that stay. Then, level by level in plies to mate, every position
+// decided at that level is unmoved: a predecessor of a loss wins one ply
+// later, a predecessor whose moves all reach wins is lost once its count
+// runs out. What is never decided is a draw.
+//
+// Generation keeps three bytes per index in memory, about 26 MB for four
+// pieces, 1.6 GB for five without pawns and 3.2 GB with them.
+
+#include "movegen.h"
+#include "tablebase.h"
+#include "thread_pool.h"
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <functional>
+#include <iostream>
+#include <memory>
+#include <mutex>
+#include <set>
+#include <string>
+#include <utility>
+#include <vector>
+
+namespace {
+    // Generation state of an index: status in the top two bits, plies to
+    // mate below. An undecided position keeps the shortest loss its exits
+    // allow instead, DONE means a draw (0) or an unused index (1).
+    const uint16_t UNKNOWN = 0;
+    const uint16_t WIN = 1 << 14;
+    const uint16_t LOSS = 2 << 14;
+    const uint16_t DONE = 3 << 14;
+    const uint16_t StatusMask = 3 << 14;
+    const uint16_t DtmMask = (1 << 14) - 1;
+    const uint16_t Unused = 0xFFFF;   // Entry code of an unused index when writing
+    const uint8_t CannotLose = 0xFF;  // Move count of a position with a drawing exit
+
+    const uint64_t SliceSize = 1 << 14;
+
+    struct Options {
+        int threads = 0;
+        bool force = false;
+    };
+
+    class Generator {
+    private:
+        TbLayout m_layout;
+        WorkStealingPool& m_pool;
+        uint64_t m_size;
+        std::unique_ptr<uint16_t[]> m_state;
+        std::unique_ptr<uint8_t[]> m_moves;  // Undecided moves that stay in the table
+        std::atomic<int> m_highest;          // Highest level with a decided position
+        std::atomic<uint64_t> m_missing;     // Exits no table covered
+        // Per level, (position, child) pairs of double steps whose en passant
+        // captures win for the opponent in that many plies
+        std::vector<std::vector<std::pair<uint64_t, uint64_t>>> m_deferred;
+        std::mutex m_deferredMutex;
+
+    public:
+        Generator(const TbLayout& layout, WorkStealingPool& pool)
+            : m_layout(layout), m_pool(pool), m_size(layout.size()), m_state(new uint16_t[m_size]),
+              m_moves(new uint8_t[m_size]), m_highest(0), m_missing(0) {}
+
+        bool generate() {
+            forSlices([this](uint64_t begin, uint64_t end) { initialize(begin, end); });
+            if (m_missing) {
+                return false;
+            }
+            for (int level = 0; level <= m_highest; ++level) {
+                forSlices([this, level](uint64_t begin, uint64_t end) { propagate(level, begin, end); });
+                if (level < int(m_deferred.size())) {
+                    for (const auto& edge : m_deferred[level]) {
+                        uint16_t child = load(edge.second);
+                        if ((child & StatusMask) != WIN || (child & DtmMask) >= level) {
+                            countWin(edge.first, level + 1);
+                        }
+                    }
+                }
+            }
+            return true;
+        }
+
+        // Writes the table file, returns its size in bytes or 0 on failure.
+        // longest is set to the longest mate in plies.
+        uint64_t write(const std::string& path, int& longest);
+
+    private:
+        void forSlices(const std::function<void(uint64_t, uint64_t)>& work) {
+            for (uint64_t begin = 0; begin < m_size; begin += SliceSize) {
+                m_pool.submit([&work, begin, this] { work(begin, std::min(m_size, begin + SliceSize)); });
+            }
+            m_pool.wait();
+        }
+
+        uint16_t load(uint64_t i) const { return __atomic_load_n(&m_state[i], __ATOMIC_RELAXED); }
+
+        void raiseHighest(int level) {
+            int highest = m_highest.load(std::memory_order_relaxed);
+            while (level > highest && !m_highest.compare_exchange_weak(highest, level)) {
+            }
+        }
+
+        void initialize(uint64_t begin, uint64_t end);
+        // Result of the opponent after move when it is known without this
+        // table: captures and promotions reach smaller tables, and a double
+        // step whose only replies are en passant captures is decided by them.
+        // Double steps whose en passant captures win for the opponent are
+        // counted as moves that stay, the count is settled by deferred.
+        bool exitResult(const Position& position, Move move, TbResult& result);
+        // Best result of the side to move among its en passant captures, false
+        // if it has none. others tells whether it has other moves.
+        bool enPassantCaptures(const Position& position, TbResult& result, bool& others);
+        void propagate(int level, uint64_t begin, uint64_t end);
+        void setWin(uint64_t i, int dtm);
+        void countWin(uint64_t i, int dtm);
+        // Calls visit with the index of every position that reaches position by
+        // a move that stays in the table. For a double step that allows en
+        // passant captures it also gets their result, which the entry of
+        // position does not include.
+        template <typename Visit>
+        void unmoves(const Position& position, const Visit& visit);
+    };
+
+    void Generator::initialize(uint64_t begin, uint64_t end) {
+        Position position;
+        for (uint64_t i = begin; i < end; ++i) {
+            m_moves[i] = 0;
+            if (!m_layout.decode(i, position)) {
+                m_state[i] = DONE | 1;
+                continue;
+            }
+            MoveList moves;
+            generateLegalMoves(position, moves);
+            if (moves.empty()) {
+                m_state[i] = position.checkers() ? LOSS : DONE;
+                continue;
+            }
+
+            int inside = 0, win = DtmMask, lossFloor = 0;
+            bool cannotLose = false;
+            for (Move move : moves) {
+                TbResult r;
+                if (!exitResult(position, move, r)) {
+                    ++inside;
+                } else if (r.wdl == WDL_LOSS) {
+                    win = std::min(win, r.dtm + 1);
+                } else if (r.wdl == WDL_WIN) {
+                    lossFloor = std::max(lossFloor, r.dtm + 1);
+                } else {
+                    cannotLose = true;
+                }
+            }
+
+            if (win != DtmMask) {
+                // A shorter win through a move that stays may still be found
+                m_state[i] = WIN | win;
+                raiseHighest(win);
+            } else if (!inside && !cannotLose) {
+                m_state[i] = LOSS | lossFloor;
+                raiseHighest(lossFloor);
+            } else {
+                m_state[i] = UNKNOWN | lossFloor;
+                m_moves[i] = cannotLose ? CannotLose : uint8_t(inside);
+            }
+        }
+    }
+
+    bool Generator::exitResult(const Position& position, Move move, TbResult& result) {
+        bool capture = position.pieceOn(move.to()) != NO_PIECE;
+        bool doubleStep = pieceType(position.pieceOn(move.from())) == PAWN && std::abs(move.to() - move.from()) == 16;
+        if (!capture && !move.isPromotion() && !doubleStep) {
+            return false;
+        }
+        Position child = position;
+        UndoRecord undo;
+        child.makeMove(move, undo);
+        if (doubleStep) {
+            bool others;
+            if (child.epSquare() == NO_SQUARE || !enPassantCaptures(child, result, others)) {
+                return false;
+            }
+            if (others && result.wdl == WDL_WIN) {
+                // The opponent wins by the capture at the latest, unless the
+                // entry of child turns out to win sooner
+                std::lock_guard<std::mutex> lock(m_deferredMutex);
+                if (int(m_deferred.size()) <= result.dtm) {
+                    m_deferred.resize(result.dtm + 1);
+                }
+                m_deferred[result.dtm].push_back({ m_layout.index(position), m_layout.index(child) });
+                raiseHighest(result.dtm);
+            }
+            return !others;
+        }
+        result = { WDL_DRAW, 0 };
+        if (popCount(child.occupied()) > 2 && !Tablebases::probe(child, result)) {
+            ++m_missing;
+        }
+        return true;
+    }
+
+    bool Generator::enPassantCaptures(const Position& position, TbResult& result, bool& others) {
+        MoveList moves;
+        generateLegalMoves(position, moves);
+        bool captures = false;
+        others = false;
+        for (Move move : moves) {
+            if (move.flag() != EN_PASSANT) {
+                others = true;
+                continue;
+            }
+            Position child = position;
+            UndoRecord undo;
+            child.makeMove(move, undo);
+            TbResult r = { WDL_DRAW, 0 };
+            if (popCount(child.occupied()) > 2 && !Tablebases::probe(child, r)) {
+                ++m_missing;
+            }
+            if (!captures || Tablebases::better(Tablebases::afterMove(r), result)) {
+                captures = true;
+                result = Tablebases::afterMove(r);
+            }
+        }
+        return captures;
+    }
+
+    void Generator::propagate(int level, uint64_t begin, uint64_t end) {
+        Position position;
+        for (uint64_t i = begin; i < end; ++i) {
+            uint16_t state = load(i);
+            uint16_t status = state & StatusMask;
+            if ((status != WIN && status != LOSS) || (state & DtmMask) != level) {
+                continue;
+            }
+            m_layout.decode(i, position);
+            if (status == LOSS) {
+                // Unless the opponent does better by taking en passant
+                unmoves(position, [this, level](uint64_t p, const TbResult* enPassant) {
+                    if (!enPassant) {
+                        setWin(p, level + 1);
+                    } else if (enPassant->wdl == WDL_LOSS) {
+                        setWin(p, std::max(level, enPassant->dtm) + 1);
+                    }
+                });
+            } else {
+                unmoves(position, [this, level](uint64_t p, const TbResult* enPassant) {
+                    if (!enPassant || enPassant->wdl != WDL_WIN || level < enPassant->dtm) {
+                        countWin(p, level + 1);
+                    }
+                });
+            }
+        }
+    }
+
+    void Generator::setWin(uint64_t i, int dtm) {
+        uint16_t state = load(i);
+        while ((state & StatusMask) == UNKNOWN || ((state & StatusMask) == WIN && (state & DtmMask) > dtm)) {
+            if (__atomic_compare_exchange_n(&m_state[i], &state, uint16_t(WIN | dtm), false, __ATOMIC_RELAXED,
+                                            __ATOMIC_RELAXED)) {
+                raiseHighest(dtm);
+                return;
+            }
+        }
+    }
+
+    // One more move of i reaches a win for the opponent. Once none is left
+    // i is lost, as late as its slowest move allows.
+    void Generator::countWin(uint64_t i, int dtm) {
+        uint16_t state = load(i);
+        if ((state & StatusMask) != UNKNOWN || __atomic_load_n(&m_moves[i], __ATOMIC_RELAXED) == CannotLose) {
+            return;
+        }
+        if (__atomic_sub_fetch(&m_moves[i], 1, __ATOMIC_RELAXED) == 0) {
+            int loss = std::max(dtm, int(state & DtmMask));
+            if (__atomic_compare_exchange_n(&m_state[i], &state, uint16_t(LOSS | loss), false, __ATOMIC_RELAXED,
+                                            __ATOMIC_RELAXED)) {
+                raiseHighest(loss);
+            }
+        }
+    }
+
+    template <typename Visit>
+    void Generator::unmoves(const Position& position, const Visit& visit) {
+        int pieces[TbLayout::MaxPieces], squares[TbLayout::MaxPieces];
+        int count = 0;
+        Bitboard occupied = position.occupied();
+        for (Bitboard b = occupied; b;) {
+            int sq = popLsb(b);
+            pieces[count] = position.pieceOn(sq);
+            squares[count++] = sq;
+        }
+
+        // The side that just moved did not capture or promote
+        Color them = ~position.sideToMove();
+        Position previous;
+        for (int k = 0; k < count; ++k) {
+            if (pieceColor(pieces[k]) != them) {
+                continue;
+            }
+            int to = squares[k];
+            Bitboard from;
+            switch (pieceType(pieces[k])) {
+                case PAWN: {
+                    int back = them == WHITE ? -8 : 8;
+                    from = squareBB(to + back) & ~occupied & ~(RANK_1_BB | RANK_8_BB);
+                    if (from && squareRank(to) == (them == WHITE ? 3 : 4)) {
+                        from |= squareBB(to + 2 * back) & ~occupied;
+                    }
+                    break;
+                }
+                case KNIGHT: from = knightAttacks(to) & ~occupied; break;
+                case BISHOP: from = bishopAttacks(to, occupied) & ~occupied; break;
+                case ROOK: from = rookAttacks(to, occupied) & ~occupied; break;
+                case QUEEN: from = queenAttacks(to, occupied) & ~occupied; break;
+                default: from = kingAttacks(to) & ~occupied; break;
+            }
+            while (from) {
+                squares[k] = popLsb(from);
+                if (!previous.setFromPieces(pieces, squares, count, them)) {
+                    continue;
+                }
+                if (std::abs(to - squares[k]) == 16 && pieceType(pieces[k]) == PAWN) {
+                    Position child = previous;
+                    UndoRecord undo;
+                    child.makeMove(Move(squares[k], to), undo);
+                    TbResult enPassant;
+                    bool others;
+                    if (child.epSquare() != NO_SQUARE && enPassantCaptures(child, enPassant, others)) {
+                        // Decided in initialize when the captures are all there is
+                        if (others) {
+                            visit(m_layout.index(previous), &enPassant);
+                        }
+                        continue;
+                    }
+                }
+                visit(m_layout.index(previous), nullptr);
+            }
+            squares[k] = to;
+        }
+    }
+
+    uint64_t Generator::write(const std::string& path, int& longest) {
+        // Final entry codes in place of the state
+        std::atomic<int> maxCode(0);
+        forSlices([this, &maxCode](uint64_t begin, uint64_t end) {
+            int highest = 0;
+            for (uint64_t i = begin; i < end; ++i) {
+                uint16_t state = m_state[i];
+                uint16_t status = state & StatusMask;
+                m_state[i] = status == UNKNOWN ? 0 : status == DONE ? (state == (DONE | 1) ? Unused : 0)
+                                                                    : uint16_t((state & DtmMask) + 1);
+                if (m_state[i] != Unused) {
+                    highest = std::max<int>(highest, m_state[i]);
+                }
+            }
+            int seen = maxCode.load();
+            while (highest > seen && !maxCode.compare_exchange_weak(seen, highest)) {
+            }
+        });
+        longest = std::max(0, maxCode - 1);
+
+        // Each block packs its entries minus their minimum, unused ones read as the minimum
+        uint64_t blockCount = (m_size + TbBlockSize - 1) / TbBlockSize;
+        std::vector<std::vector<unsigned char>> blocks(blockCount);
+        for (uint64_t b = 0; b < blockCount; ++b) {
+            m_pool.submit([this, &blocks, b] {
+                uint64_t begin = b * TbBlockSize, end = std::min(m_size, begin + TbBlockSize);
+                int low = Unused, high = 0;
+                for (uint64_t i = begin; i < end; ++i) {
+                    if (m_state[i] != Unused) {
+                        low = std::min<int>(low, m_state[i]);
+                        high = std::max<int>(high, m_state[i]);
+                    }
+                }
+                if (low == Unused) {
+                    low = high = 0;
+                }
+                int width = 0;
+                while ((high - low) >> width) {
+                    ++width;
+                }
+                std::vector<unsigned char>& out = blocks[b];
+                out.assign(3 + ((end - begin) * width + 7) / 8, 0);
+                out[0] = uint8_t(low);
+                out[1] = uint8_t(low >> 8);
+                out[2] = uint8_t(width);
+                for (uint64_t i = begin; width && i < end; ++i) {
+                    uint32_t value = m_state[i] == Unused ? 0 : m_state[i] - low;
+                    uint64_t bit = (i - begin) * width;
+                    for (int j = 0; j < width; ++j, ++bit) {
+                        out[3 + bit / 8] |= uint8_t((value >> j & 1) << (bit % 8));
+                    }
+                }
+            });
+        }
+        m_pool.wait();
+
+        FILE* file = std::fopen(path.c_str(), "wb");
+        if (!file) {
+            return 0;
+        }
+        TbHeader header = {};
+        std::memcpy(header.magic, TbMagic, sizeof(TbMagic));
+        std::strncpy(header.name, m_layout.name().c_str(), sizeof(header.name) - 1);
+        header.entries = m_size;
+        header.blocks = blockCount;
+        bool ok = std::fwrite(&header, sizeof(header), 1, file) == 1;
+        uint64_t offset = 0;
+        for (uint64_t b = 0; b <= blockCount; ++b) {
+            ok = ok && std::fwrite(&offset, 8, 1, file) == 1;
+            offset += b < blockCount ? blocks[b].size() : 0;
+        }
+        for (const std::vector<unsigned char>& block : blocks) {
+            ok = ok && std::fwrite(block.data(), 1, block.size(), file) == block.size();
+        }
+        const unsigned char padding[8] = {};
+        ok = ok && std::fwrite(padding, 1, sizeof(padding), file) == sizeof(padding);
+        ok = std::fclose(file) == 0 && ok;
+        return ok ? sizeof(header) + (blockCount + 1) * 8 + offset + sizeof(padding) : 0;
+    }
+
+    // Name of the material left when piece is captured, or turned into
+    // promoted when that is not NO_PIECE. Empty for lone kings.
+    std::string successor(const TbLayout& layout, int slot, int promoted) {
+        std::string sides[2];
+        for (int i = 0; i < layout.count(); ++i) {
+            int piece = i == slot ? promoted : layout.piece(i);
+            if (piece != NO_PIECE) {
+                sides[pieceColor(piece)] += "PNBRQK"[pieceType(piece)];
+            }
+        }
+        TbLayout next;
+        return next.parse(sides[WHITE] + "v" + sides[BLACK]) ? next.name() : std::string();
+    }
+
+    bool exists(const std::string& path) {
+        FILE* file = std::fopen(path.c_str(), "rb");
+        if (file) {
+            std::fclose(file);
+        }
+        return file != nullptr;
+    }
+
+    // Makes the table of name after the tables it depends on.
+    bool make(const std::string& name, const std::string& directory, bool force, WorkStealingPool& pool,
+              std::set<std::string>& done) {
+        TbLayout layout;
+        if (!layout.parse(name)) {
+            std::cerr << "Bad material " << name << std::endl;
+            return false;
+        }
+        if (!done.insert(layout.name()).second && !force) {
+            return true;
+        }
+        for (int slot = 2; slot < layout.count(); ++slot) {
+            std::vector<std::string> next = { successor(layout, slot, NO_PIECE) };
+            if (pieceType(layout.piece(slot)) == PAWN) {
+                for (PieceType pt : { QUEEN, ROOK, BISHOP, KNIGHT }) {
+                    next.push_back(successor(layout, slot, makePiece(pieceColor(layout.piece(slot)), pt)));
+                }
+            }
+            for (const std::string& table : next) {
+                if (!table.empty() && !make(table, directory, false, pool, done)) {
+                    return false;
+                }
+            }
+        }
+
+        std::string path = directory + "/" + layout.name() + ".ctb";
+        if (!force && exists(path)) {
+            return true;
+        }
+        auto start = std::chrono::steady_clock::now();
+        Tablebases::init(directory);
+        Generator generator(layout, pool);
+        if (!generator.generate()) {
+            std::cerr << layout.name() << ": a smaller table is missing or unreadable" << std::endl;
+            return false;
+        }
+        int longest = 0;
+        uint64_t bytes = generator.write(path, longest);
+        if (!bytes) {
+            std::cerr << "Cannot write " << path << std::endl;
+            return false;
+        }
+        double seconds = std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+        std::cerr << layout.name() << ": " << layout.size() << " entries  Longest mate: " << longest
+                  << " plies  Size: " << bytes << " bytes  Time: " << int(seconds * 1000) << " ms" << std::endl;
+        return true;
+    }
+
+    void usage() {
+        std::cerr << "Usage: tbgen [--threads n] [--force] <directory> <material>..." << std::endl;
+    }
+}
+
+int main(int argc, char* argv[]) {
+    Options options;
+    std::vector<std::string> args;
+    for (int i = 1; i < argc; ++i) {
+        if (std::strcmp(argv[i], "--threads") == 0 && i + 1 < argc) {
+            options.threads = std::atoi(argv[++i]);
+        } else if (std::strcmp(argv[i], "--force") == 0) {
+            options.force = true;
+        } else {
+            args.push_back(argv[i]);
+        }
+    }
+    if (args.size() < 2) {
+        usage();
+        return 1;
+    }
+    Bitboards::init();
+
+    WorkStealingPool pool(options.threads);
+    std::set<std::string> done;
+    for (size_t i = 1; i < args.size(); ++i) {
+        if (!make(args[i], args[0], options.force, pool, done)) {
+            return 1;
+        }
+    }
+    std::cerr << "Tables: " << Tablebases::init(args[0]) << "  Threads: " << pool.size() << std::endl;
+    return 0;
+}
@@ -0,0 +1,104 @@
+#include "thread_pool.h"
+#include <algorithm>
+
+namespace {
+    thread_local const WorkStealingPool* CurrentPool = nullptr;
+    thread_local int CurrentWorker = -1;
+}
+
+WorkStealingPool::WorkStealingPool(int threads)
+    : m_nextQueue(0), m_queued(0), m_pending(0), m_shutdown(false) {
+    if (threads <= 0) {
+        threads = std::max(1u, std::thread::hardware_concurrency());
+    }
+    for (int i = 0; i < threads; ++i) {
+        m_queues.emplace_back(new Queue());
+    }
+    for (int i = 0; i < threads; ++i) {
+        m_threads.emplace_back(&WorkStealingPool::workerLoop, this, i);
+    }
+}
+
+WorkStealingPool::~WorkStealingPool() {
+    wait();
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        m_shutdown = true;
+    }
+    m_wake.notify_all();
+    for (std::thread& thread : m_threads) {
+        thread.join();
+    }
+}
+
+void WorkStealingPool::submit(Task task) {
+    int id = CurrentPool == this ? CurrentWorker : int(m_nextQueue++ % m_queues.size());
+    {
+        std::lock_guard<std::mutex> lock(m_queues[id]->mutex);
+        m_queues[id]->tasks.push_back(std::move(task));
+    }
+    {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        ++m_queued;
+        ++m_pending;
+    }
+    m_wake.notify_one();
+}
+
+void WorkStealingPool::wait() {
+    std::unique_lock<std::mutex> lock(m_mutex);
+    m_done.wait(lock, [this] { return m_pending == 0; });
+}
+
+// Own deque from the back, then the others from the front.
+bool WorkStealingPool::takeTask(int id, Task& task) {
+    int count = int(m_queues.size());
+    for (int i = 0; i < count; ++i) {
+        Queue& queue = *m_queues[(id + i) % count];
+        std::lock_guard<std::mutex> lock(queue.mutex);
+        if (queue.tasks.empty()) {
+            continue;
+        }
+        if (i == 0) {
+            task = std::move(queue.tasks.back());
+            queue.tasks.pop_back();
+        } else {
+            task = std::move(queue.tasks.front());
+            queue.tasks.pop_front();
+        }
+        return true;
+    }
+    return false;
+}
+
+void WorkStealingPool::workerLoop(int id) {
+    CurrentPool = this;
+    CurrentWorker = id;
+    Task task;
+    while (true) {
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_wake.wait(lock, [this] { return m_shutdown || m_queued > 0; });
+            if (m_queued == 0) {
+                return;  // Shut down with nothing left to do
+            }
+        }
+        if (!takeTask(id, task)) {
+            continue;  // Another worker was faster
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            --m_queued;
+        }
+        task();
+        task = nullptr;
+        bool idle;
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            idle = --m_pending == 0;
+        }
+        if (idle) {
+            m_done.notify_all();
+        }
+    }
+}
@@ -0,0 +1,57 @@
+// Fixed set of worker threads with one task deque each. A worker runs its
+// own tasks newest first and, once it runs dry, steals the oldest task of
+// another worker, so tasks of uneven size still keep every core busy.
+
+#ifndef THREAD_POOL_H
+#define THREAD_POOL_H
+
+#include <atomic>
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+class WorkStealingPool {
+public:
+    typedef std::function<void()> Task;
+
+private:
+    struct Queue {
+        std::mutex mutex;
+        std::deque<Task> tasks;
+    };
+
+    std::vector<std::unique_ptr<Queue>> m_queues;
+    std::vector<std::thread> m_threads;
+    std::atomic<unsigned> m_nextQueue;
+    std::mutex m_mutex;
+    std::condition_variable m_wake;
+    std::condition_variable m_done;
+    int m_queued;   // Tasks waiting in a deque, guarded by m_mutex
+    int m_pending;  // Tasks submitted and not finished yet, guarded by m_mutex
+    bool m_shutdown;
+
+public:
+    // threads <= 0 uses one thread per hardware core.
+    explicit WorkStealingPool(int threads = 0);
+    ~WorkStealingPool();
+    WorkStealingPool(const WorkStealingPool&) = delete;
+    WorkStealingPool& operator=(const WorkStealingPool&) = delete;
+
+    int size() const { return int(m_threads.size()); }
+
+    // Queues task. From a worker it goes to that worker's own deque,
+    // otherwise the deques take turns.
+    void submit(Task task);
+    // Blocks until every submitted task has finished.
+    void wait();
+
+private:
+    void workerLoop(int id);
+    bool takeTask(int id, Task& task);
+};
+
+#endif
@@ -0,0 +1,124 @@
+#include "tt.h"
+#include <algorithm>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#ifdef __linux__
+#include <sys/mman.h>
+#endif
+
+namespace {
+    // data layout: move 16 | score 16 | depth 8 | bound 2 | generation 6
+    uint64_t pack(Move move, int score, int depth, Bound bound, uint8_t generation) {
+        return uint64_t(move.raw())
+             | uint64_t(uint16_t(int16_t(score))) << 16
+             | uint64_t(uint8_t(depth)) << 32
+             | uint64_t(bound) << 40
+             | uint64_t(generation) << 42;
+    }
+
+    Move dataMove(uint64_t data) { return Move::fromRaw(uint16_t(data)); }
+    int dataScore(uint64_t data) { return int16_t(uint16_t(data >> 16)); }
+    int dataDepth(uint64_t data) { return uint8_t(data >> 32); }
+    Bound dataBound(uint64_t data) { return Bound((data >> 40) & 3); }
+    uint8_t dataGeneration(uint64_t data) { return uint8_t((data >> 42) & 63); }
+
+    uint64_t load(const uint64_t& word) { return __atomic_load_n(&word, __ATOMIC_RELAXED); }
+    void save(uint64_t& word, uint64_t value) { __atomic_store_n(&word, value, __ATOMIC_RELAXED); }
+
+    const size_t HugePageSize = 2 * 1024 * 1024;
+}
+
+TranspositionTable::TranspositionTable(size_t megabytes, bool hugePages)
+    : m_buckets(nullptr), m_bucketCount(0), m_allocatedBytes(0), m_hugePages(hugePages), m_generation(0) {
+    resize(megabytes);
+}
+
+TranspositionTable::~TranspositionTable() {
+    release();
+}
+
+void TranspositionTable::release() {
+    std::free(m_buckets);
+    m_buckets = nullptr;
+    m_bucketCount = 0;
+    m_allocatedBytes = 0;
+}
+
+void TranspositionTable::resize(size_t megabytes) {
+    release();
+    size_t bytes = std::max<size_t>(megabytes, 1) << 20;
+    size_t alignment = m_hugePages ? HugePageSize : alignof(Bucket);
+    size_t allocated = (bytes + alignment - 1) / alignment * alignment;
+    m_buckets = static_cast<Bucket*>(std::aligned_alloc(alignment, allocated));
+    if (!m_buckets) {
+        std::cerr << "Failed to allocate a " << megabytes << " MB transposition table" << std::endl;
+        std::exit(EXIT_FAILURE);
+    }
+#if defined(__linux__) && defined(MADV_HUGEPAGE)
+    if (m_hugePages) {
+        madvise(m_buckets, allocated, MADV_HUGEPAGE);
+    }
+#endif
+    m_allocatedBytes = allocated;
+    m_bucketCount = bytes / sizeof(Bucket);
+    clear();
+}
+
+void TranspositionTable::clear() {
+    std::memset(m_buckets, 0, m_allocatedBytes);
+    m_generation = 0;
+}
+
+bool TranspositionTable::probe(uint64_t key, TTData& data) {
+    Bucket& b = bucket(key);
+    for (Entry& e : b.entries) {
+        uint64_t word = load(e.data);
+        if ((load(e.keyXorData) ^ word) == key && dataBound(word) != BOUND_NONE) {
+            data.move = dataMove(word);
+            data.score = dataScore(word);
+            data.depth = dataDepth(word);
+            data.bound = dataBound(word);
+            return true;
+        }
+    }
+    return false;
+}
+
+void TranspositionTable::store(uint64_t key, Move move, int score, int depth, Bound bound) {
+    Bucket& b = bucket(key);
+    Entry* replace = &b.entries[0];
+    int worst = 1 << 30;
+    for (Entry& e : b.entries) {
+        uint64_t word = load(e.data);
+        if ((load(e.keyXorData) ^ word) == key) {
+            // Same position, keep the old move if the new search has none
+            if (move == Move::none()) {
+                move = dataMove(word);
+            }
+            replace = &e;
+            break;
+        }
+        int age = (m_generation - dataGeneration(word)) & 63;
+        int value = dataBound(word) == BOUND_NONE ? -(1 << 20) : dataDepth(word) - 8 * age;
+        if (value < worst) {
+            worst = value;
+            replace = &e;
+        }
+    }
+    uint64_t word = pack(move, score, std::max(depth, 0), bound, m_generation);
+    save(replace->data, word);
+    save(replace->keyXorData, key ^ word);
+}
+
+int TranspositionTable::hashfull() const {
+    int used = 0, sampled = 0;
+    for (size_t i = 0; i < 250 && i < m_bucketCount; ++i) {
+        for (const Entry& e : m_buckets[i].entries) {
+            uint64_t word = load(e.data);
+            used += dataBound(word) != BOUND_NONE && dataGeneration(word) == m_generation;
+            ++sampled;
+        }
+    }
+    return sampled ? used * 1000 / sampled : 0;
+}
@@ -0,0 +1,75 @@
+// Transposition table shared by every search thread.
+//
+// Entries are 16 bytes, four to a 64-byte bucket so a probe touches one
+// cache line. There are no locks: an entry stores its data word next to
+// key ^ data, a torn write by another thread fails that check and reads
+// as a miss.
+
+#ifndef TT_H
+#define TT_H
+
+#include "move.h"
+#include <cstddef>
+#include <cstdint>
+
+enum Bound : uint8_t {
+    BOUND_NONE,
+    BOUND_UPPER,
+    BOUND_LOWER,
+    BOUND_EXACT
+};
+
+struct TTData {
+    Move move;
+    int score;
+    int depth;
+    Bound bound;
+};
+
+class TranspositionTable {
+public:
+    static const int BucketSize = 4;
+
+private:
+    struct Entry {
+        uint64_t keyXorData;
+        uint64_t data;
+    };
+    struct alignas(64) Bucket {
+        Entry entries[BucketSize];
+    };
+
+    Bucket* m_buckets;
+    size_t m_bucketCount;
+    size_t m_allocatedBytes;
+    bool m_hugePages;
+    uint8_t m_generation;
+
+public:
+    // hugePages asks the kernel to back the table with 2 MB pages (Linux).
+    explicit TranspositionTable(size_t megabytes = 16, bool hugePages = true);
+    ~TranspositionTable();
+    TranspositionTable(const TranspositionTable&) = delete;
+    TranspositionTable& operator=(const TranspositionTable&) = delete;
+
+    void resize(size_t megabytes);
+    void clear();
+    // Starts a new search, older entries age and become cheaper to replace.
+    void newSearch() { m_generation = (m_generation + 1) & 63; }
+
+    bool probe(uint64_t key, TTData& data);
+    // Replaces the entry of the same key, otherwise the shallowest and oldest one in the bucket.
+    void store(uint64_t key, Move move, int score, int depth, Bound bound);
+
+    size_t sizeMB() const { return m_bucketCount * sizeof(Bucket) >> 20; }
+    // Permille of a sample of entries written during the current search.
+    int hashfull() const;
+
+private:
+    Bucket& bucket(uint64_t key) const {
+        return m_buckets[size_t((unsigned __int128)key * m_bucketCount >> 64)];
+    }
+    void release();
+};
+
+#endif
@@ -0,0 +1,297 @@
+#include "uci.h"
+#include "movegen.h"
+#include "nnue.h"
+#include "tablebase.h"
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <sstream>
+
+namespace {
+    const char* const EngineName = "Chess-With-OOP";
+    const int DefaultHashMB = 16;
+    const int MaxHashMB = 65536;
+
+    std::string scoreToUci(int score) {
+        if (score >= VALUE_MATE_IN_MAX_PLY) {
+            return "mate " + std::to_string((VALUE_MATE - score + 1) / 2);
+        }
+        if (score <= -VALUE_MATE_IN_MAX_PLY) {
+            return "mate " + std::to_string(-(VALUE_MATE + score) / 2);
+        }
+        return "cp " + std::to_string(score);
+    }
+
+    Move parseMove(const Position& position, const std::string& text) {
+        MoveList moves;
+        generateLegalMoves(position, moves);
+        for (Move move : moves) {
+            if (moveToString(move) == text) {
+                return move;
+            }
+        }
+        return Move::none();
+    }
+}
+
+Uci::Uci()
+    : m_tt(DefaultHashMB), m_search(m_tt), m_random(std::random_device()()), m_holdBestMove(false), m_infinite(false),
+      m_stopRequested(false), m_ponderhitRequested(false) {
+    m_position.setStartPosition();
+}
+
+Uci::~Uci() {
+    stop();
+    waitForSearch();
+}
+
+void Uci::loop(std::istream& in) {
+    std::string line, command;
+    while (std::getline(in, line)) {
+        std::istringstream is(line);
+        command.clear();
+        is >> command;
+        if (command == "uci") {
+            send(std::string("id name ") + EngineName);
+            send("id author ju4700");
+            send("option name Hash type spin default " + std::to_string(DefaultHashMB) + " min 1 max " + std::to_string(MaxHashMB));
+            send("option name Threads type spin default 1 min 1 max " + std::to_string(Search::MaxThreads));
+            send("option name Ponder type check default false");
+            send("option name Book type string default <empty>");
+            send("option name TablebasePath type string default <empty>");
+            send("option name EvalFile type string default <empty>");
+            send("uciok");
+        } else if (command == "isready") {
+            send("readyok");
+        } else if (command == "ucinewgame") {
+            stop();
+            waitForSearch();
+            m_tt.clear();
+        } else if (command == "setoption") {
+            setOption(is);
+        } else if (command == "position") {
+            stop();
+            waitForSearch();
+            position(is);
+        } else if (command == "go") {
+            go(is);
+        } else if (command == "stop") {
+            stop();
+        } else if (command == "ponderhit") {
+            ponderhit();
+        } else if (command == "quit") {
+            break;
+        }
+    }
+    stop();
+    waitForSearch();
+}
+
+// position startpos|fen <fen> [moves <move>...]
+void Uci::position(std::istringstream& is) {
+    std::string token, fen;
+    is >> token;
+    if (token == "startpos") {
+        m_position.setStartPosition();
+        is >> token;
+    } else if (token == "fen") {
+        while (is >> token && token != "moves") {
+            fen += token + " ";
+        }
+        Position parsed;
+        if (!parsed.setFromFen(fen)) {
+            send("info string invalid fen " + fen);
+            return;
+        }
+        m_position = parsed;
+    } else {
+        return;
+    }
+    m_history.clear();
+    while (is >> token) {
+        Move move = parseMove(m_position, token);
+        if (move == Move::none()) {
+            send("info string illegal move " + token);
+            break;
+        }
+        m_history.push_back(m_position.key());
+        UndoRecord undo;
+        m_position.makeMove(move, undo);
+        if (m_position.halfmoveClock() == 0) {
+            m_history.clear();
+        }
+    }
+}
+
+// go [wtime|btime|winc|binc|movestogo|depth|nodes|movetime <n>]... [infinite] [ponder]
+void Uci::go(std::istringstream& is) {
+    stop();  // A search still running, infinite or pondering, would never end on its own
+    waitForSearch();
+    SearchLimits limits;
+    std::string token;
+    while (is >> token) {
+        if (token == "wtime") {
+            is >> limits.time[WHITE];
+        } else if (token == "btime") {
+            is >> limits.time[BLACK];
+        } else if (token == "winc") {
+            is >> limits.increment[WHITE];
+        } else if (token == "binc") {
+            is >> limits.increment[BLACK];
+        } else if (token == "movestogo") {
+            is >> limits.movesToGo;
+        } else if (token == "depth") {
+            is >> limits.depth;
+        } else if (token == "nodes") {
+            is >> limits.nodes;
+        } else if (token == "movetime") {
+            is >> limits.moveTime;
+        } else if (token == "infinite") {
+            limits.infinite = true;
+        } else if (token == "ponder") {
+            limits.ponder = true;
+        }
+    }
+    limits.depth = std::max(1, std::min(limits.depth, MAX_PLY - 1));
+
+    // A book move is answered at once, except when asked to think on
+    if (m_book.isOpen() && !limits.infinite && !limits.ponder) {
+        Move move = m_book.probe(m_position, uint32_t(m_random()));
+        if (move != Move::none()) {
+            send("bestmove " + moveToString(move));
+            return;
+        }
+    }
+
+    {
+        std::lock_guard<std::mutex> lock(m_stateMutex);
+        m_infinite = limits.infinite;
+        m_holdBestMove = limits.infinite || limits.ponder;
+        m_stopRequested = false;
+        m_ponderhitRequested = false;
+    }
+    m_searchThread = std::thread(&Uci::think, this, limits);
+}
+
+// setoption name <id> [value <x>]
+void Uci::setOption(std::istringstream& is) {
+    std::string token, name, value;
+    is >> token;
+    while (is >> token && token != "value") {
+        name += (name.empty() ? "" : " ") + token;
+    }
+    std::getline(is >> std::ws, value);
+    stop();
+    waitForSearch();
+    if (name == "Hash") {
+        m_tt.resize(std::max(1, std::min(std::atoi(value.c_str()), MaxHashMB)));
+    } else if (name == "Threads") {
+        m_search.setThreads(std::atoi(value.c_str()));
+    } else if (name == "Book") {
+        if (value.empty() || value == "<empty>") {
+            m_book.close();
+        } else if (!m_book.open(value)) {
+            send("info string cannot open book " + value);
+        }
+    } else if (name == "TablebasePath") {
+        if (value.empty() || value == "<empty>") {
+            Tablebases::release();
+        } else {
+            send("info string " + std::to_string(Tablebases::init(value)) + " tablebases in " + value);
+        }
+    } else if (name == "EvalFile") {
+        if (value.empty() || value == "<empty>") {
+            Nnue::release();
+        } else if (Nnue::load(value)) {
+            send("info string network " + value + " with " + std::to_string(Nnue::hiddenSize()) + " hidden units, " +
+                 Nnue::simdName());
+        } else {
+            send("info string cannot load network " + value);
+        }
+    } else if (name != "Ponder") {
+        send("info string unknown option " + name);
+    }
+}
+
+void Uci::stop() {
+    {
+        std::lock_guard<std::mutex> lock(m_stateMutex);
+        m_holdBestMove = false;
+        m_stopRequested = true;
+    }
+    m_stateChanged.notify_all();
+    m_search.stop();
+}
+
+void Uci::ponderhit() {
+    m_search.ponderhit();
+    {
+        std::lock_guard<std::mutex> lock(m_stateMutex);
+        m_holdBestMove = m_infinite;
+        m_ponderhitRequested = true;
+    }
+    m_stateChanged.notify_all();
+}
+
+void Uci::waitForSearch() {
+    if (m_searchThread.joinable()) {
+        m_searchThread.join();
+    }
+}
+
+// Runs on the search thread.
+void Uci::think(SearchLimits limits) {
+    m_lastPv.clear();
+    {
+        std::lock_guard<std::mutex> lock(m_stateMutex);
+        if (m_ponderhitRequested) {
+            limits.ponder = false;
+        }
+    }
+    Move best = m_search.think(m_position, limits, m_history, [this](const SearchInfo& info) {
+        // think() clears a stop or ponderhit that came in while it was starting
+        bool stopRequested, ponderhitRequested;
+        {
+            std::lock_guard<std::mutex> lock(m_stateMutex);
+            stopRequested = m_stopRequested;
+            ponderhitRequested = m_ponderhitRequested;
+        }
+        if (stopRequested) {
+            m_search.stop();
+        } else if (ponderhitRequested && m_search.pondering()) {
+            m_search.ponderhit();
+        }
+        sendInfo(info);
+    });
+
+    // The protocol forbids answering an infinite or ponder search early
+    {
+        std::unique_lock<std::mutex> lock(m_stateMutex);
+        m_stateChanged.wait(lock, [this] { return !m_holdBestMove; });
+    }
+
+    if (best == Move::none()) {
+        send("bestmove 0000");
+    } else if (m_lastPv.size() > 1 && m_lastPv[0] == best) {
+        send("bestmove " + moveToString(best) + " ponder " + moveToString(m_lastPv[1]));
+    } else {
+        send("bestmove " + moveToString(best));
+    }
+}
+
+void Uci::send(const std::string& line) {
+    std::lock_guard<std::mutex> lock(m_outputMutex);
+    std::cout << line << std::endl;
+}
+
+void Uci::sendInfo(const SearchInfo& info) {
+    m_lastPv = info.pv;
+    std::ostringstream os;
+    uint64_t nps = info.timeMs ? info.nodes * 1000 / info.timeMs : info.nodes * 1000;
+    os << "info depth " << info.depth << " score " << scoreToUci(info.score) << " nodes " << info.nodes
+       << " nps " << nps << " hashfull " << m_tt.hashfull() << " time " << info.timeMs << " pv";
+    for (Move move : info.pv) {
+        os << " " << moveToString(move);
+    }
+    send(os.str());
+}
@@ -0,0 +1,58 @@
+// Universal Chess Interface front end for match managers and GUIs.
+//
+// Runs without SDL. The calling thread only reads and parses commands,
+// every go starts a search thread that streams info lines and answers
+// with bestmove, so stop and ponderhit are handled while it thinks.
+
+#ifndef UCI_H
+#define UCI_H
+
+#include "book.h"
+#include "search.h"
+#include <condition_variable>
+#include <iosfwd>
+#include <mutex>
+#include <random>
+#include <string>
+#include <thread>
+#include <vector>
+
+class Uci {
+private:
+    TranspositionTable m_tt;
+    Search m_search;
+    OpeningBook m_book;
+    std::mt19937 m_random;  // Picks between book moves
+    Position m_position;
+    std::vector<uint64_t> m_history;  // Keys of the game before m_position, since the last irreversible move
+    std::thread m_searchThread;
+    std::mutex m_outputMutex;
+    std::mutex m_stateMutex;
+    std::condition_variable m_stateChanged;
+    bool m_holdBestMove;  // Infinite and ponder searches answer only after stop or ponderhit
+    bool m_infinite;
+    bool m_stopRequested;       // Reapplied once Search::think() has cleared its own flags
+    bool m_ponderhitRequested;
+    std::vector<Move> m_lastPv;
+
+public:
+    Uci();
+    ~Uci();
+
+    // Processes commands until quit or the end of the input.
+    void loop(std::istream& in);
+
+private:
+    void position(std::istringstream& is);
+    void go(std::istringstream& is);
+    void setOption(std::istringstream& is);
+    void stop();
+    void ponderhit();
+    void waitForSearch();
+
+    void think(SearchLimits limits);
+    void send(const std::string& line);
+    void sendInfo(const SearchInfo& info);
+};
+
+#endif
@@ -0,0 +1,492 @@
+// Chess rules templated on the board geometry (geometry.h), for variants.
+//
+// VariantPosition<G> keeps one board per colour and piece type plus a
+// square-indexed mailbox, and generates strictly legal moves from check
+// and pin masks like movegen.cpp does. Boards ten files wide also have the
+// Capablanca compounds: the archbishop (bishop + knight, 'A') and the
+// chancellor (rook + knight, 'C'), which pawns may promote to. Castling
+// follows Capablanca chess: the king ends two files in from its corner
+// (c or the next to last file) with the rook beside it on the inside.
+// Standard chess keeps its own Position and movegen;
+// VariantPosition<StandardBoard> plays the same rules on the same magic
+// tables and is checked against it by perft.
+
+#ifndef VARIANT_H
+#define VARIANT_H
+
+#include "geometry.h"
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <sstream>
+#include <string>
+
+enum VariantPieceType { V_PAWN, V_KNIGHT, V_BISHOP, V_ROOK, V_QUEEN, V_KING, V_ARCHBISHOP, V_CHANCELLOR, V_PIECE_TYPES };
+
+struct VariantMove {
+    enum Flag : uint8_t { NORMAL, DOUBLE_PUSH, EN_PASSANT, PROMOTION, CASTLING };
+
+    uint8_t from;
+    uint8_t to;         // The rook's square for CASTLING
+    uint8_t flag;
+    uint8_t promotion;  // VariantPieceType for PROMOTION
+
+    bool operator==(const VariantMove& other) const {
+        return from == other.from && to == other.to && flag == other.flag && promotion == other.promotion;
+    }
+};
+
+struct VariantMoveList {
+    static const int Capacity = 512;
+
+    VariantMove moves[Capacity];
+    int count = 0;
+
+    void add(int from, int to, int flag = VariantMove::NORMAL, int promotion = 0) {
+        moves[count++] = { uint8_t(from), uint8_t(to), uint8_t(flag), uint8_t(promotion) };
+    }
+    int size() const { return count; }
+    const VariantMove* begin() const { return moves; }
+    const VariantMove* end() const { return moves + count; }
+};
+
+template <typename G>
+class VariantPosition {
+public:
+    typedef typename G::Board Board;
+    static constexpr bool HasCompounds = G::Width >= 10;
+    static constexpr int NoSquare = 255;
+    static constexpr int NoPiece = 255;
+
+private:
+    Board m_pieces[2][V_PIECE_TYPES];
+    Board m_colors[2];
+    uint8_t m_board[G::Squares];     // Piece type plus V_PIECE_TYPES for black, NoPiece if empty
+    uint8_t m_castlingRooks[2][2];   // King side and queen side rook of each colour, NoSquare without the right
+    uint8_t m_sideToMove;
+    uint8_t m_epSquare;
+    uint16_t m_halfmoveClock;
+    uint16_t m_fullmoveNumber;
+
+public:
+    VariantPosition() { clear(); }
+
+    Color sideToMove() const { return Color(m_sideToMove); }
+    int halfmoveClock() const { return m_halfmoveClock; }
+    int epSquare() const { return m_epSquare; }
+    Board pieces(Color c, VariantPieceType pt) const { return m_pieces[c][pt]; }
+    Board pieces(Color c) const { return m_colors[c]; }
+    Board occupied() const { return m_colors[WHITE] | m_colors[BLACK]; }
+
+    // Piece letters PNBRQK plus AC on wide boards, ranks may hold
+    // two-digit counts of empty squares ("10"). KQkq name the outermost
+    // rook on that side of the king on its first rank, rights without one
+    // are dropped, and so is an en passant square no double push can have
+    // left. False if the text is not a playable position of this geometry.
+    bool setFromFen(const std::string& fen) {
+        static const char Letters[] = "pnbrqkac";
+        std::istringstream in(fen);
+        std::string board, side = "w", castling, ep = "-";
+        int halfmove = 0, fullmove = 1;
+        if (!(in >> board)) {
+            return false;
+        }
+        in >> side >> castling >> ep >> halfmove >> fullmove;
+        clear();
+        int rank = G::Height - 1, file = 0;
+        for (size_t i = 0; i < board.size(); ++i) {
+            char c = board[i];
+            if (c == '/') {
+                if (file != G::Width || --rank < 0) {
+                    return false;
+                }
+                file = 0;
+            } else if (c >= '0' && c <= '9') {
+                int empty = c - '0';
+                if (i + 1 < board.size() && board[i + 1] >= '0' && board[i + 1] <= '9') {
+                    empty = empty * 10 + board[++i] - '0';
+                }
+                file += empty;
+            } else {
+                const char* p = std::strchr(Letters, c | 0x20);
+                int pt = p ? int(p - Letters) : V_PIECE_TYPES;
+                if (!p || pt >= (HasCompounds ? V_PIECE_TYPES : V_ARCHBISHOP) || file >= G::Width) {
+                    return false;
+                }
+                put(c & 0x20 ? BLACK : WHITE, VariantPieceType(pt), G::square(file, rank));
+                ++file;
+            }
+        }
+        if (rank != 0 || file != G::Width || (side != "w" && side != "b")) {
+            return false;
+        }
+        m_sideToMove = side == "b" ? BLACK : WHITE;
+        for (Color c : { WHITE, BLACK }) {
+            if (popCount(m_pieces[c][V_KING]) != 1) {
+                return false;
+            }
+        }
+        if ((m_pieces[WHITE][V_PAWN] | m_pieces[BLACK][V_PAWN]) & (G::rankMask(0) | G::rankMask(G::Height - 1))) {
+            return false;
+        }
+        // The side that just moved cannot be left in check
+        if (attacked(kingSquare(~sideToMove()), sideToMove(), occupied())) {
+            return false;
+        }
+
+        for (char c : castling) {
+            Color color = c & 0x20 ? BLACK : WHITE;
+            int wing = (c | 0x20) == 'k' ? 0 : (c | 0x20) == 'q' ? 1 : -1;
+            int ksq = kingSquare(color), backRank = color == WHITE ? 0 : G::Height - 1;
+            if (wing < 0 || G::rank(ksq) != backRank) {
+                continue;
+            }
+            // Outermost rook of that side
+            int step = wing == 0 ? 1 : -1;
+            for (int f = wing == 0 ? G::Width - 1 : 0; f != G::file(ksq); f -= step) {
+                int sq = G::square(f, backRank);
+                if (m_pieces[color][V_ROOK] & G::bit(sq)) {
+                    m_castlingRooks[color][wing] = uint8_t(sq);
+                    break;
+                }
+            }
+        }
+
+        Color us = sideToMove();
+        if (ep.size() >= 2 && ep[0] >= 'a' && ep[0] < 'a' + G::Width) {
+            int epFile = ep[0] - 'a', epRank = std::atoi(ep.c_str() + 1) - 1;
+            if (epRank == (us == WHITE ? G::Height - 3 : 2)) {
+                int sq = G::square(epFile, epRank);
+                int pushed = us == WHITE ? sq - G::Width : sq + G::Width;
+                int origin = us == WHITE ? sq + G::Width : sq - G::Width;
+                if ((m_pieces[~us][V_PAWN] & G::bit(pushed)) && !(occupied() & (G::bit(sq) | G::bit(origin))) &&
+                    (G::pawnAttacks(~us, sq) & m_pieces[us][V_PAWN])) {
+                    m_epSquare = uint8_t(sq);
+                }
+            }
+        }
+        m_halfmoveClock = uint16_t(halfmove);
+        m_fullmoveNumber = uint16_t(fullmove);
+        return true;
+    }
+
+    std::string toFen() const {
+        static const char Letters[] = "PNBRQKAC";
+        std::string fen;
+        for (int rank = G::Height - 1; rank >= 0; --rank) {
+            int empty = 0;
+            for (int file = 0; file < G::Width; ++file) {
+                int piece = pieceOn(G::square(file, rank));
+                if (piece == NoPiece) {
+                    ++empty;
+                    continue;
+                }
+                if (empty) {
+                    fen += std::to_string(empty);
+                    empty = 0;
+                }
+                fen += char(Letters[piece % V_PIECE_TYPES] | (piece >= V_PIECE_TYPES ? 0x20 : 0));
+            }
+            if (empty) {
+                fen += std::to_string(empty);
+            }
+            fen += rank ? "/" : "";
+        }
+        fen += sideToMove() == WHITE ? " w " : " b ";
+        std::string castling;
+        for (int i = 0; i < 4; ++i) {
+            if (m_castlingRooks[i / 2][i % 2] != NoSquare) {
+                castling += "KQkq"[i];
+            }
+        }
+        fen += castling.empty() ? "-" : castling;
+        fen += ' ';
+        fen += m_epSquare == NoSquare ? "-" : squareName(m_epSquare);
+        return fen + " " + std::to_string(m_halfmoveClock) + " " + std::to_string(m_fullmoveNumber);
+    }
+
+    // Piece type on sq, plus V_PIECE_TYPES for black, NoPiece if empty.
+    int pieceOn(int sq) const { return m_board[sq]; }
+
+    static std::string squareName(int sq) {
+        return char('a' + G::file(sq)) + std::to_string(G::rank(sq) + 1);
+    }
+
+    // Coordinates as UCI writes them, castling as the king's two-square step.
+    static std::string moveName(const VariantMove& move) {
+        int to = move.to;
+        if (move.flag == VariantMove::CASTLING) {
+            to = castlingKingTarget(move.from, move.to);
+        }
+        std::string name = squareName(move.from) + squareName(to);
+        if (move.flag == VariantMove::PROMOTION) {
+            name += "pnbrqkac"[move.promotion];
+        }
+        return name;
+    }
+
+    int kingSquare(Color c) const { return lsb(m_pieces[c][V_KING]); }
+
+    // Pieces of color by attacking sq, sliders seen through occupied.
+    Board attackers(int sq, Color by, Board occupied) const {
+        const Board* them = m_pieces[by];
+        Board knights = them[V_KNIGHT] | them[V_ARCHBISHOP] | them[V_CHANCELLOR];
+        Board diagonal = them[V_BISHOP] | them[V_QUEEN] | them[V_ARCHBISHOP];
+        Board straight = them[V_ROOK] | them[V_QUEEN] | them[V_CHANCELLOR];
+        return (G::pawnAttacks(~by, sq) & them[V_PAWN]) | (G::knightAttacks(sq) & knights)
+             | (G::kingAttacks(sq) & them[V_KING]) | (G::bishopAttacks(sq, occupied) & diagonal)
+             | (G::rookAttacks(sq, occupied) & straight);
+    }
+
+    bool attacked(int sq, Color by, Board occupied) const { return attackers(sq, by, occupied) != 0; }
+    bool inCheck() const { return attacked(kingSquare(sideToMove()), ~sideToMove(), occupied()); }
+
+    // Plays a legal move in place.
+    void play(const VariantMove& move) {
+        Color us = sideToMove(), them = ~us;
+        int moved = pieceOn(move.from) % V_PIECE_TYPES;
+        ++m_halfmoveClock;
+        if (move.flag == VariantMove::CASTLING) {
+            int kingTo = castlingKingTarget(move.from, move.to);
+            remove(us, V_KING, move.from);
+            remove(us, V_ROOK, move.to);
+            put(us, V_KING, kingTo);
+            put(us, V_ROOK, kingTo + (kingTo > move.from ? -1 : 1));
+        } else {
+            int captured = pieceOn(move.to);
+            if (captured != NoPiece) {
+                remove(them, VariantPieceType(captured % V_PIECE_TYPES), move.to);
+                m_halfmoveClock = 0;
+            }
+            remove(us, VariantPieceType(moved), move.from);
+            put(us, move.flag == VariantMove::PROMOTION ? VariantPieceType(move.promotion) : VariantPieceType(moved), move.to);
+            if (move.flag == VariantMove::EN_PASSANT) {
+                remove(them, V_PAWN, us == WHITE ? move.to - G::Width : move.to + G::Width);
+            }
+        }
+        if (moved == V_PAWN) {
+            m_halfmoveClock = 0;
+        }
+        // A right goes when its king or rook moves or the rook is taken
+        for (int c = 0; c < 2; ++c) {
+            for (int side = 0; side < 2; ++side) {
+                int rook = m_castlingRooks[c][side];
+                if (rook == move.from || rook == move.to || (c == us && moved == V_KING)) {
+                    m_castlingRooks[c][side] = NoSquare;
+                }
+            }
+        }
+        m_epSquare = NoSquare;
+        if (move.flag == VariantMove::DOUBLE_PUSH) {
+            int skipped = (move.from + move.to) / 2;
+            if (G::pawnAttacks(us, skipped) & m_pieces[them][V_PAWN]) {
+                m_epSquare = uint8_t(skipped);
+            }
+        }
+        m_fullmoveNumber += us == BLACK;
+        m_sideToMove = them;
+    }
+
+    // Strictly legal moves: king steps away from attacked squares, other
+    // pieces within the check mask and, when pinned, along the pin line.
+    void generateLegal(VariantMoveList& list) const {
+        list.count = 0;
+        Color us = sideToMove(), them = ~us;
+        int ksq = kingSquare(us);
+        Board occ = occupied();
+        Board own = m_colors[us];
+
+        for (Board targets = G::kingAttacks(ksq) & ~own; targets;) {
+            int to = popLsb(targets);
+            if (!attacked(to, them, occ ^ G::bit(ksq))) {
+                list.add(ksq, to);
+            }
+        }
+        Board checkers = attackers(ksq, them, occ);
+        if (checkers & (checkers - 1)) {
+            return;  // Double check, only the king can move
+        }
+        Board checkMask = ~Board(0);
+        if (checkers) {
+            checkMask = G::between(ksq, lsb(checkers)) | checkers;
+        } else {
+            generateCastling(list, us, ksq, occ);
+        }
+        Board pinned = pinnedPieces(us, ksq);
+        Board targets = ~own & checkMask;
+
+        for (int pt = V_KNIGHT; pt < V_PIECE_TYPES; ++pt) {
+            if (pt == V_KING) {
+                continue;
+            }
+            // A pinned knight can never move along the pin
+            Board pieces = m_pieces[us][pt] & ~(pt == V_KNIGHT ? pinned : 0);
+            while (pieces) {
+                int from = popLsb(pieces);
+                Board attacks = pieceAttacks(pt, from, occ) & targets;
+                if (pinned & G::bit(from)) {
+                    attacks &= G::line(ksq, from);
+                }
+                for (; attacks;) {
+                    list.add(from, popLsb(attacks));
+                }
+            }
+        }
+        generatePawnMoves(list, us, ksq, occ, pinned, checkMask);
+    }
+
+private:
+    void clear() {
+        std::memset(m_pieces, 0, sizeof(m_pieces));
+        std::memset(m_colors, 0, sizeof(m_colors));
+        std::memset(m_board, NoPiece, sizeof(m_board));
+        std::memset(m_castlingRooks, NoSquare, sizeof(m_castlingRooks));
+        m_sideToMove = WHITE;
+        m_epSquare = NoSquare;
+        m_halfmoveClock = 0;
+        m_fullmoveNumber = 1;
+    }
+
+    void put(Color c, VariantPieceType pt, int sq) {
+        m_pieces[c][pt] |= G::bit(sq);
+        m_colors[c] |= G::bit(sq);
+        m_board[sq] = uint8_t(pt + c * V_PIECE_TYPES);
+    }
+
+    void remove(Color c, VariantPieceType pt, int sq) {
+        m_pieces[c][pt] &= ~G::bit(sq);
+        m_colors[c] &= ~G::bit(sq);
+        m_board[sq] = NoPiece;
+    }
+
+    // c or the next to last file on the king's rank.
+    static int castlingKingTarget(int king, int rook) {
+        return G::square(rook > king ? G::Width - 2 : 2, G::rank(king));
+    }
+
+    static Board pieceAttacks(int pt, int sq, Board occ) {
+        Board attacks = 0;
+        if (pt == V_KNIGHT || pt == V_ARCHBISHOP || pt == V_CHANCELLOR) {
+            attacks |= G::knightAttacks(sq);
+        }
+        if (pt == V_BISHOP || pt == V_QUEEN || pt == V_ARCHBISHOP) {
+            attacks |= G::bishopAttacks(sq, occ);
+        }
+        if (pt == V_ROOK || pt == V_QUEEN || pt == V_CHANCELLOR) {
+            attacks |= G::rookAttacks(sq, occ);
+        }
+        return attacks;
+    }
+
+    // Pieces of color c that are the only blocker between their king and an enemy slider.
+    Board pinnedPieces(Color c, int ksq) const {
+        const Board* them = m_pieces[~c];
+        Board diagonal = them[V_BISHOP] | them[V_QUEEN] | them[V_ARCHBISHOP];
+        Board straight = them[V_ROOK] | them[V_QUEEN] | them[V_CHANCELLOR];
+        Board snipers = (G::bishopAttacks(ksq, m_colors[~c]) & diagonal) | (G::rookAttacks(ksq, m_colors[~c]) & straight);
+        Board pinned = 0;
+        Board occ = occupied();
+        while (snipers) {
+            Board blockers = G::between(ksq, popLsb(snipers)) & occ;
+            if (blockers && !(blockers & (blockers - 1))) {
+                pinned |= blockers & m_colors[c];
+            }
+        }
+        return pinned;
+    }
+
+    // The king may not castle out of, through or into check. The squares
+    // both pieces cross must be empty but for the two of them, and the
+    // king's target is tested with the rook already moved.
+    void generateCastling(VariantMoveList& list, Color us, int ksq, Board occ) const {
+        for (int side = 0; side < 2; ++side) {
+            int rook = m_castlingRooks[us][side];
+            if (rook == NoSquare) {
+                continue;
+            }
+            int kingTo = castlingKingTarget(ksq, rook);
+            int rookTo = kingTo + (side == 0 ? -1 : 1);
+            Board pieces = G::bit(ksq) | G::bit(rook);
+            Board path = G::between(ksq, kingTo) | G::bit(kingTo) | G::between(rook, rookTo) | G::bit(rookTo);
+            if (path & occ & ~pieces) {
+                continue;
+            }
+            bool safe = true;
+            for (Board crossed = G::between(ksq, kingTo); crossed && safe;) {
+                safe = !attacked(popLsb(crossed), ~us, occ);
+            }
+            Board after = (occ ^ pieces) | G::bit(kingTo) | G::bit(rookTo);
+            if (safe && !attacked(kingTo, ~us, after)) {
+                list.add(ksq, rook, VariantMove::CASTLING);
+            }
+        }
+    }
+
+    void addPawnMove(VariantMoveList& list, int from, int to, int flag, Color us) const {
+        int lastRank = us == WHITE ? G::Height - 1 : 0;
+        if (G::rank(to) != lastRank) {
+            list.add(from, to, flag);
+            return;
+        }
+        for (int pt = HasCompounds ? V_CHANCELLOR : V_QUEEN; pt >= V_KNIGHT; --pt) {
+            if (pt != V_KING) {
+                list.add(from, to, VariantMove::PROMOTION, pt);
+            }
+        }
+    }
+
+    void generatePawnMoves(VariantMoveList& list, Color us, int ksq, Board occ, Board pinned, Board checkMask) const {
+        Color them = ~us;
+        int forward = us == WHITE ? G::Width : -G::Width;
+        int startRank = us == WHITE ? 1 : G::Height - 2;
+        for (Board pawns = m_pieces[us][V_PAWN]; pawns;) {
+            int from = popLsb(pawns);
+            Board allowed = checkMask;
+            if (pinned & G::bit(from)) {
+                allowed &= G::line(ksq, from);
+            }
+            int to = from + forward;
+            if (!(occ & G::bit(to))) {
+                if (allowed & G::bit(to)) {
+                    addPawnMove(list, from, to, VariantMove::NORMAL, us);
+                }
+                int twice = to + forward;
+                if (G::rank(from) == startRank && !(occ & G::bit(twice)) && (allowed & G::bit(twice))) {
+                    list.add(from, twice, VariantMove::DOUBLE_PUSH);
+                }
+            }
+            for (Board captures = G::pawnAttacks(us, from) & m_colors[them] & allowed; captures;) {
+                addPawnMove(list, from, popLsb(captures), VariantMove::NORMAL, us);
+            }
+
+            // En passant removes two pieces from one rank, which no pin mask
+            // covers, so it is checked against the resulting occupancy instead
+            if (m_epSquare != NoSquare && (G::pawnAttacks(us, from) & G::bit(m_epSquare))) {
+                int victim = m_epSquare - forward;
+                Board after = (occ ^ G::bit(from) ^ G::bit(victim)) | G::bit(m_epSquare);
+                if (!(attackers(ksq, them, after) & ~G::bit(victim))) {
+                    list.add(from, m_epSquare, VariantMove::EN_PASSANT);
+                }
+            }
+        }
+    }
+};
+
+// Leaf nodes of the legal move tree, for checking the generator.
+template <typename G>
+uint64_t variantPerft(const VariantPosition<G>& position, int depth) {
+    VariantMoveList moves;
+    position.generateLegal(moves);
+    if (depth <= 1) {
+        return depth == 1 ? uint64_t(moves.size()) : 1;
+    }
+    uint64_t nodes = 0;
+    for (const VariantMove& move : moves) {
+        VariantPosition<G> after = position;
+        after.play(move);
+        nodes += variantPerft(after, depth - 1);
+    }
+    return nodes;
+}
+
+#endif
@@ -0,0 +1,48 @@
+// Zobrist keys: one random 64-bit number per piece and square, castling
+// rights combination, en-passant file and side to move. A position's key is
+// the XOR of the numbers of everything in it.
+
+#ifndef ZOBRIST_H
+#define ZOBRIST_H
+
+#include <cstdint>
+
+namespace Zobrist {
+    struct Keys {
+        uint64_t psq[12][64];
+        uint64_t castling[16];
+        uint64_t enPassant[8];
+        uint64_t side;
+    };
+
+    // splitmix64, run at compile time so the keys are identical in every build
+    constexpr uint64_t next(uint64_t& state) {
+        uint64_t z = (state += 0x9E3779B97F4A7C15ULL);
+        z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+        z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+        return z ^ (z >> 31);
+    }
+
+    constexpr Keys generate() {
+        Keys keys = {};
+        uint64_t state = 1070372;
+        for (auto& piece : keys.psq) {
+            for (auto& key : piece) {
+                key = next(state);
+            }
+        }
+        for (auto& key : keys.castling) {
+            key = next(state);
+        }
+        keys.castling[0] = 0;
+        for (auto& key : keys.enPassant) {
+            key = next(state);
+        }
+        keys.side = next(state);
+        return keys;
+    }
+
+    inline constexpr Keys keys = generate();
+}
+
+#endif